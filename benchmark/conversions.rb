@@ -0,0 +1,23 @@
+# Measures round-trips of values between ruby and V8.
+#
+#   rake benchmark:conversions COUNT=100000
+#
+require File.expand_path('../../lib/mustang', __FILE__)
+require 'benchmark'
+
+count = (ENV['COUNT'] || 100_000).to_i
+cxt = Mustang::Context.new
+cxt.enter
+cxt.eval("function id(x) { return x; }", "<benchmark>")
+id = cxt[:id]
+
+obj = cxt.eval("({foo: 1, bar: 'baz'})", "<benchmark>")
+ary = cxt.eval("[1, 2, 3]", "<benchmark>")
+func = cxt.eval("(function() {})", "<benchmark>")
+
+Benchmark.bm(12) do |x|
+  x.report("primitives:") { count.times { id.call(nil); id.call(true); id.call(1) } }
+  x.report("objects:")    { count.times { id.call(obj) } }
+  x.report("arrays:")     { count.times { id.call(ary) } }
+  x.report("functions:")  { count.times { id.call(func) } }
+end
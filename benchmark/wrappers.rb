@@ -0,0 +1,28 @@
+# Measures how much ruby heap and GC time is used by reflected V8 values.
+#
+#   rake benchmark:wrappers COUNT=100000
+#
+require File.expand_path('../../lib/mustang', __FILE__)
+
+count = (ENV['COUNT'] || 100_000).to_i
+cxt = Mustang::Context.new
+cxt.enter
+
+live_objects = lambda {
+  GC.start
+  stats = ObjectSpace.count_objects
+  stats[:TOTAL] - stats[:FREE]
+}
+
+before = live_objects.call
+values = cxt.eval("var a = []; for (var i = 0; i < #{count}; i++) { a.push({}) }; a", "<benchmark>").to_a
+after = live_objects.call
+
+started = Time.now
+5.times { GC.start }
+gc_time = (Time.now - started) / 5
+
+puts "Reflected values:            #{values.size}"
+puts "Ruby objects per value:      %.2f" % ((after - before).to_f / count)
+puts "Live hashes:                 #{ObjectSpace.count_objects[:T_HASH]}"
+puts "Full GC with values alive:   %.2fms" % (gc_time * 1000)
@@ -22,6 +22,14 @@ def cpu_x64?
   end
 end
 
+def snapshot?
+  ENV['V8_SNAPSHOT'] == 'yes' || !snapshot_libraries.empty?
+end
+
+def snapshot_libraries
+  (ENV['V8_SNAPSHOT_LIBRARIES'] || '').split(':').map { |lib| File.expand_path(lib) }
+end
+
 def make_sure_scons_installed!
   unless `hash scons; echo $?`.to_i == 0
     raise RuntimeError, "ERROR: To compile V8 engine you need to install the Scons library!"
@@ -35,13 +43,17 @@ def compile_vendor_v8!(dir)
   begin
     make_sure_scons_installed!
     defaults, ENV['CCFLAGS'] = ENV['CCFLAGS'], flags
+    libraries, ENV['V8_SNAPSHOT_LIBRARIES'] = ENV['V8_SNAPSHOT_LIBRARIES'], snapshot_libraries.join(':')
     puts "-"*30
-    compile_cmd = "cd #{dir} && scons mode=#{debug? ? 'debug' : 'release'} snapshot=off library=static arch=#{arch}"
+    compile_cmd = "cd #{dir} && scons mode=#{debug? ? 'debug' : 'release'} snapshot=#{snapshot? ? 'on' : 'off'} library=static arch=#{arch}"
     puts compile_cmd
-    system compile_cmd
+    unless system(compile_cmd)
+      raise RuntimeError, "ERROR: Compilation of V8 engine failed (#{$?.to_s})!"
+    end
     puts "-"*30
   ensure
     ENV['CCFLAGS'] = defaults
+    ENV['V8_SNAPSHOT_LIBRARIES'] = libraries
   end
 end
 
@@ -53,6 +65,7 @@ unless find_library('v8', nil, lib)
   $LOCAL_LIBS << Dir[File.join(VENDOR_V8_DIR, "**/**/libv8.a")].first
   dir_config('v8', File.join(VENDOR_V8_DIR, "include"), VENDOR_V8_DIR)
   find_library('v8', nil, VENDOR_V8_DIR)
+  $defs << "-DHAVE_V8_SNAPSHOT" if snapshot?
 end
 
 have_library('pthread')
@@ -62,6 +75,15 @@ have_header('v8-debug.h')
 have_header('v8-profiler.h')
 have_func('rb_sym_to_s')
 have_func('rb_any_to_ary')
+have_func('rb_proc_call_with_block')
+have_func('rb_method_call')
+have_func('rb_check_id')
+have_func('rb_objspace_garbage_object_p')
+have_header('ruby/encoding.h')
+have_header('ruby/thread.h')
+have_func('rb_thread_call_without_gvl', 'ruby/thread.h')
+have_func('rb_thread_call_with_gvl', 'ruby/thread.h')
+have_func('pthread_condattr_setclock', 'pthread.h')
 
 CONFIG['LDSHARED'] = '$(CXX) -shared' unless darwin?
 
@@ -1,9 +1,16 @@
 #include "v8_main.h"
+#include "v8_locker.h"
+#include "v8_heap.h"
+#include "v8_profiler.h"
+#include "v8_heap_snapshot.h"
 #include "v8_cast.h"
 #include "v8_base.h"
 #include "v8_context.h"
+#include "v8_script.h"
 #include "v8_value.h"
 #include "v8_object.h"
+#include "v8_proxy.h"
+#include "v8_buffer.h"
 #include "v8_string.h"
 #include "v8_integer.h"
 #include "v8_number.h"
@@ -14,18 +21,27 @@
 #include "v8_external.h"
 #include "v8_boolean.h"
 #include "v8_errors.h"
+#include "v8_json.h"
+#include "v8_isolate.h"
 
 extern "C" void Init_v8() {
   Init_V8();
+  Init_V8_Locker();
+  Init_V8_Heap();
+  Init_V8_Profiler();
+  Init_V8_HeapSnapshot();
   Init_V8_Cast();
   Init_V8_Data();
   Init_V8_Empty();
   Init_V8_Undefined();
   Init_V8_Null();
   Init_V8_Context();
+  Init_V8_Script();
   Init_V8_Value();
   Init_V8_Primitive();
   Init_V8_Object();
+  Init_V8_Proxy();
+  Init_V8_Buffer();
   Init_V8_String();
   Init_V8_Integer();
   Init_V8_Number();
@@ -36,4 +52,6 @@ extern "C" void Init_v8() {
   Init_V8_External();
   Init_V8_Boolean();
   Init_V8_Errors();
+  Init_V8_JSON();
+  Init_V8_Isolate();
 }
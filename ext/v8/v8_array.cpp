@@ -1,6 +1,9 @@
 #include "v8_ref.h"
 #include "v8_cast.h"
+#include "v8_base.h"
 #include "v8_object.h"
+#include "v8_integer.h"
+#include "v8_number.h"
 #include "v8_string.h"
 #include "v8_macros.h"
 
@@ -11,16 +14,65 @@ UNWRAPPER(Array);
 
 /* Typecasting helpers */
 
+/*
+ * Returns type of items when all of them are fixnums, floats or strings,
+ * otherwise returns <code>T_NONE</code>. Such homogeneous arrays can be
+ * converted without dispatching each item through generic typecasting.
+ *
+ */
+static int v8_array_homogeneous_type(VALUE value)
+{
+  int_r len = RARRAY_LEN(value);
+  VALUE *ptr = RARRAY_PTR(value);
+  int type = len > 0 ? TYPE(ptr[0]) : T_NONE;
+
+  if (type != T_FIXNUM && type != T_FLOAT && type != T_STRING) {
+    return T_NONE;
+  }
+  for (int_r i = 1; i < len; i++) {
+    if (TYPE(ptr[i]) != type) {
+      return T_NONE;
+    }
+  }
+
+  return type;
+}
+
 Handle<Value> to_v8_array(VALUE value)
 {
   HandleScope scope;
-  Local<Array> ary = Array::New();
+  int_r len = RARRAY_LEN(value);
+  Local<Array> ary = Array::New(len);
 
-  for (int_r i = 0; i < RARRAY_LEN(value); i++) {
-    ary->Set(i, to_v8(rb_ary_entry(value, i)));
+  switch (v8_array_homogeneous_type(value)) {
+  case T_FIXNUM:
+    for (int_r i = 0; i < len; i++) {
+      HandleScope item_scope;
+      ary->Set(i, to_v8_integer(RARRAY_PTR(value)[i]));
+    }
+    break;
+  case T_FLOAT:
+    for (int_r i = 0; i < len; i++) {
+      HandleScope item_scope;
+      ary->Set(i, to_v8_number(RARRAY_PTR(value)[i]));
+    }
+    break;
+  case T_STRING:
+    for (int_r i = 0; i < len; i++) {
+      HandleScope item_scope;
+      ary->Set(i, to_v8_string(RARRAY_PTR(value)[i]));
+    }
+    break;
+  default:
+    // Nested items can run ruby code (eg. Range#to_a), which may change
+    // length of this array, so it's checked on each iteration.
+    for (int_r i = 0; i < RARRAY_LEN(value); i++) {
+      HandleScope item_scope;
+      ary->Set(i, to_v8(rb_ary_entry(value, i)));
+    }
   }
-  
-  return ary;
+
+  return scope.Close(ary);
 }
 
 /* V8::Array methods */
@@ -65,21 +117,190 @@ static VALUE rb_v8_array_to_a(VALUE self)
   return ary;
 }
 
+/* Returns ruby array with converted items of given slice. */
+static VALUE v8_array_slice(Handle<Array> ary, long start, long len)
+{
+  VALUE result = rb_ary_new2(len);
+
+  for (long i = 0; i < len; i++) {
+    HandleScope scope;
+    rb_ary_store(result, i, to_ruby(ary->Get(start + i)));
+  }
+
+  return result;
+}
+
 /*
  * call-seq:
- *   ary[key]      => value
- *   ary.get(key)  => value
+ *   ary[key]             => value
+ *   ary[start, length]   => array or nil
+ *   ary[range]           => array or nil
+ *   ary.get(key)         => value
  *
- * Returns value of specified array entry.
+ * Returns value of specified array entry, or ruby array with entries of
+ * given slice. Only entries within the slice are converted.
  *
- *   ary = cxt.evaluate("['foo', 'bar'];")
- *   ary[0] # => 'foo'
+ *   ary = cxt.evaluate("['foo', 'bar', 'spam'];")
+ *   ary[0]    # => 'foo'
+ *   ary[1..2] # => ['bar', 'spam']
  *
  */
-static VALUE rb_v8_array_get(VALUE self, VALUE key)
+static VALUE rb_v8_array_get(int argc, VALUE *argv, VALUE self)
 {
   HandleScope scope;
-  return to_ruby(unwrap(self)->Get(NUM2UINT(key)));
+
+  if (argc < 1 || argc > 2) {
+    rb_raise(rb_eArgError, "wrong number of arguments (%d for 1..2)", argc);
+    return Qnil;
+  }
+
+  Handle<Array> ary = unwrap(self);
+  long length = ary->Length();
+  long start, len;
+
+  if (argc == 2) {
+    start = NUM2LONG(argv[0]);
+    len = NUM2LONG(argv[1]);
+
+    if (start < 0) {
+      start += length;
+    }
+    if (start < 0 || start > length || len < 0) {
+      return Qnil;
+    }
+    if (start + len > length) {
+      len = length - start;
+    }
+
+    return v8_array_slice(ary, start, len);
+  }
+
+  switch (rb_range_beg_len(argv[0], &start, &len, length, 0)) {
+  case Qfalse:
+    break;
+  case Qnil:
+    return Qnil;
+  default:
+    return v8_array_slice(ary, start, len);
+  }
+
+  return to_ruby(ary->Get(NUM2UINT(argv[0])));
+}
+
+/*
+ * call-seq:
+ *   ary.each { |value| ... }  => ary
+ *   ary.each                  => enumerator
+ *
+ * Yields each array entry. Entries are converted one by one while iterating,
+ * so breaking out of the block (eg. in <code>#first</code> or <code>#find</code>)
+ * doesn't convert the rest of them.
+ *
+ */
+static VALUE rb_v8_array_each(VALUE self)
+{
+  RETURN_ENUMERATOR(self, 0, 0);
+  int state = 0;
+
+  {
+    HandleScope scope;
+    Handle<Array> ary = unwrap(self);
+
+    for (unsigned int i = 0; i < ary->Length() && state == 0; i++) {
+      HandleScope item_scope;
+      rb_protect(rb_yield, to_ruby(ary->Get(i)), &state);
+    }
+  }
+
+  // Block can break or raise, so it's rethrown after handle scopes have
+  // been closed...
+  if (state != 0) {
+    rb_jump_tag(state);
+  }
+
+  return self;
+}
+
+static VALUE v8_array_yield_with_index(VALUE pair)
+{
+  return rb_yield_values(2, RARRAY_PTR(pair)[0], RARRAY_PTR(pair)[1]);
+}
+
+/*
+ * call-seq:
+ *   ary.each_with_index { |value, index| ... }  => ary
+ *   ary.each_with_index                         => enumerator
+ *
+ * Yields each array entry together with its index.
+ *
+ */
+static VALUE rb_v8_array_each_with_index(VALUE self)
+{
+  RETURN_ENUMERATOR(self, 0, 0);
+  int state = 0;
+
+  {
+    HandleScope scope;
+    Handle<Array> ary = unwrap(self);
+
+    for (unsigned int i = 0; i < ary->Length() && state == 0; i++) {
+      HandleScope item_scope;
+      VALUE pair = rb_assoc_new(to_ruby(ary->Get(i)), UINT2NUM(i));
+      rb_protect(v8_array_yield_with_index, pair, &state);
+    }
+  }
+
+  if (state != 0) {
+    rb_jump_tag(state);
+  }
+
+  return self;
+}
+
+/*
+ * call-seq:
+ *   ary.include?(value)  => true or false
+ *
+ * Returns <code>true</code> when given value is one of array entries.
+ * Primitive values and reflected V8 values are compared within V8, so
+ * entries are not converted at all. Other ruby objects are compared with
+ * converted entries, until the first match.
+ *
+ */
+static VALUE rb_v8_array_include_p(VALUE self, VALUE value)
+{
+  HandleScope scope;
+  Handle<Array> ary = unwrap(self);
+
+  switch (TYPE(value)) {
+  case T_NIL: case T_TRUE: case T_FALSE: case T_FIXNUM: case T_BIGNUM:
+  case T_FLOAT: case T_STRING: case T_SYMBOL:
+    break;
+  default:
+    if (!rb_obj_is_kind_of(value, rb_cV8Data)) {
+      for (unsigned int i = 0; i < ary->Length(); i++) {
+        HandleScope item_scope;
+
+        if (rb_equal(to_ruby(ary->Get(i)), value)) {
+          return Qtrue;
+        }
+      }
+
+      return Qfalse;
+    }
+  }
+
+  Handle<Value> _value = to_v8(value);
+
+  for (unsigned int i = 0; i < ary->Length(); i++) {
+    HandleScope item_scope;
+
+    if (ary->Get(i)->StrictEquals(_value)) {
+      return Qtrue;
+    }
+  }
+
+  return Qfalse;
 }
 
 /*
@@ -152,12 +373,15 @@ void Init_V8_Array()
   rb_cV8Array = rb_define_class_under(rb_mV8, "Array", rb_cV8Object);
   rb_define_singleton_method(rb_cV8Array, "new", RUBY_METHOD_FUNC(rb_v8_array_new), -2);
   rb_define_method(rb_cV8Array, "to_a", RUBY_METHOD_FUNC(rb_v8_array_to_a), 0);
-  rb_define_method(rb_cV8Array, "[]", RUBY_METHOD_FUNC(rb_v8_array_get), 1);
-  rb_define_method(rb_cV8Array, "get", RUBY_METHOD_FUNC(rb_v8_array_get), 1);
+  rb_define_method(rb_cV8Array, "[]", RUBY_METHOD_FUNC(rb_v8_array_get), -1);
+  rb_define_method(rb_cV8Array, "get", RUBY_METHOD_FUNC(rb_v8_array_get), -1);
   rb_define_method(rb_cV8Array, "[]=", RUBY_METHOD_FUNC(rb_v8_array_set), 2);
   rb_define_method(rb_cV8Array, "set", RUBY_METHOD_FUNC(rb_v8_array_set), 2);
   rb_define_method(rb_cV8Array, "push", RUBY_METHOD_FUNC(rb_v8_array_push), 1);
   rb_define_method(rb_cV8Array, "<<", RUBY_METHOD_FUNC(rb_v8_array_push), 1);
   rb_define_method(rb_cV8Array, "length", RUBY_METHOD_FUNC(rb_v8_array_length), 0);
   rb_define_method(rb_cV8Array, "size", RUBY_METHOD_FUNC(rb_v8_array_length), 0);  
+  rb_define_method(rb_cV8Array, "each", RUBY_METHOD_FUNC(rb_v8_array_each), 0);
+  rb_define_method(rb_cV8Array, "each_with_index", RUBY_METHOD_FUNC(rb_v8_array_each_with_index), 0);
+  rb_define_method(rb_cV8Array, "include?", RUBY_METHOD_FUNC(rb_v8_array_include_p), 1);
 }
@@ -11,6 +11,9 @@ VALUE rb_cV8Data;
 VALUE rb_cV8EmptyClass;
 VALUE rb_cV8UndefinedClass;
 VALUE rb_cV8NullClass;
+VALUE rb_oV8Empty;
+VALUE rb_oV8Undefined;
+VALUE rb_oV8Null;
 
 /* V8::Data methods */
 
@@ -127,7 +130,8 @@ void Init_V8_Empty()
 {
   rb_cV8EmptyClass = rb_define_class_under(rb_mV8, "EmptyClass", rb_cV8Data);
   rb_define_method(rb_cV8EmptyClass, "to_s", RUBY_METHOD_FUNC(rb_v8_empty_to_s), 0);
-  rb_define_const(rb_mV8, "Empty", rb_funcall2(rb_cV8EmptyClass, rb_intern("new"), 0, NULL));
+  rb_oV8Empty = rb_funcall2(rb_cV8EmptyClass, rb_intern("new"), 0, NULL);
+  rb_define_const(rb_mV8, "Empty", rb_oV8Empty);
 }
 
 /* V8::Undefined initializer */
@@ -135,7 +139,8 @@ void Init_V8_Undefined()
 {
   rb_cV8UndefinedClass = rb_define_class_under(rb_mV8, "UndefinedClass", rb_cV8Data);
   rb_define_method(rb_cV8UndefinedClass, "to_s", RUBY_METHOD_FUNC(rb_v8_undefined_to_s), 0);
-  rb_define_const(rb_mV8, "Undefined", rb_funcall2(rb_cV8UndefinedClass, rb_intern("new"), 0, NULL));
+  rb_oV8Undefined = rb_funcall2(rb_cV8UndefinedClass, rb_intern("new"), 0, NULL);
+  rb_define_const(rb_mV8, "Undefined", rb_oV8Undefined);
 }
 
 /* V8::Null initializer */
@@ -143,5 +148,6 @@ void Init_V8_Null()
 {
   rb_cV8NullClass = rb_define_class_under(rb_mV8, "NullClass", rb_cV8Data);
   rb_define_method(rb_cV8NullClass, "to_s", RUBY_METHOD_FUNC(rb_v8_null_to_s), 0);  
-  rb_define_const(rb_mV8, "Null", rb_funcall2(rb_cV8NullClass, rb_intern("new"), 0, NULL));
+  rb_oV8Null = rb_funcall2(rb_cV8NullClass, rb_intern("new"), 0, NULL);
+  rb_define_const(rb_mV8, "Null", rb_oV8Null);
 }
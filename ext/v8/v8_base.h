@@ -13,6 +13,10 @@ RUBY_EXTERN VALUE rb_cV8EmptyClass;
 RUBY_EXTERN VALUE rb_cV8UndefinedClass;
 /* V8::NullClass class */
 RUBY_EXTERN VALUE rb_cV8NullClass;
+/* V8::Empty, V8::Undefined and V8::Null singletons */
+RUBY_EXTERN VALUE rb_oV8Empty;
+RUBY_EXTERN VALUE rb_oV8Undefined;
+RUBY_EXTERN VALUE rb_oV8Null;
 
 /* API */
 void Init_V8_Data();
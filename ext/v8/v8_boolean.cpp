@@ -10,6 +10,8 @@ using namespace v8;
 VALUE rb_cV8Boolean;
 VALUE rb_cV8FalseClass;
 VALUE rb_cV8TrueClass;
+VALUE rb_oV8False;
+VALUE rb_oV8True;
 
 /* Booleans initializer */
 void Init_V8_Boolean()
@@ -20,10 +22,12 @@ void Init_V8_Boolean()
   /* false */
   args = Qfalse;
   rb_cV8FalseClass = rb_define_class_under(rb_mV8, "FalseClass", rb_cV8Boolean);
-  rb_define_const(rb_mV8, "False", rb_funcall2(rb_cV8FalseClass, rb_intern("new"), 1, &args));
+  rb_oV8False = rb_funcall2(rb_cV8FalseClass, rb_intern("new"), 1, &args);
+  rb_define_const(rb_mV8, "False", rb_oV8False);
 
   /* true */
   args = Qtrue;
   rb_cV8TrueClass = rb_define_class_under(rb_mV8, "TrueClass", rb_cV8Boolean);
-  rb_define_const(rb_mV8, "True", rb_funcall2(rb_cV8TrueClass, rb_intern("new"), 1, &args));
+  rb_oV8True = rb_funcall2(rb_cV8TrueClass, rb_intern("new"), 1, &args);
+  rb_define_const(rb_mV8, "True", rb_oV8True);
 }
@@ -11,6 +11,9 @@ RUBY_EXTERN VALUE rb_cV8Boolean;
 RUBY_EXTERN VALUE rb_cV8FalseClass;
 /* V8::TrueClass class */
 RUBY_EXTERN VALUE rb_cV8TrueClass;
+/* V8::False and V8::True singletons */
+RUBY_EXTERN VALUE rb_oV8False;
+RUBY_EXTERN VALUE rb_oV8True;
 
 /* API */
 void Init_V8_Boolean();
@@ -0,0 +1,207 @@
+#include "v8_ref.h"
+#include "v8_cast.h"
+#include "v8_object.h"
+#include "v8_buffer.h"
+#include "v8_macros.h"
+
+#include <string.h>
+#include <limits.h>
+
+using namespace v8;
+
+VALUE rb_cV8Buffer;
+UNWRAPPER(Object);
+
+/* Local helpers */
+
+/* Element type of buffer. */
+struct v8_buffer_type {
+  const char *name;
+  ExternalArrayType type;
+  int size;
+};
+
+static v8_buffer_type buffer_types[] = {
+  { "int8",   kExternalByteArray,          1 },
+  { "uint8",  kExternalUnsignedByteArray,  1 },
+  { "int16",  kExternalShortArray,         2 },
+  { "uint16", kExternalUnsignedShortArray, 2 },
+  { "int32",  kExternalIntArray,           4 },
+  { "uint32", kExternalUnsignedIntArray,   4 },
+  { "float",  kExternalFloatArray,         4 },
+  { NULL,     kExternalByteArray,          0 }
+};
+
+static v8_buffer_type *v8_buffer_type_by_name(VALUE name)
+{
+  const char *str = rb_id2name(rb_to_id(name));
+
+  for (v8_buffer_type *t = buffer_types; t->name != NULL; t++) {
+    if (strcmp(t->name, str) == 0) {
+      return t;
+    }
+  }
+
+  rb_raise(rb_eArgError, "unknown buffer type: %s", str);
+  return NULL;
+}
+
+static v8_buffer_type *v8_buffer_type_of(Handle<Object> obj)
+{
+  ExternalArrayType type = obj->GetIndexedPropertiesExternalArrayDataType();
+
+  for (v8_buffer_type *t = buffer_types; t->name != NULL; t++) {
+    if (t->type == type) {
+      return t;
+    }
+  }
+
+  return &buffer_types[1];
+}
+
+/* V8::Buffer methods */
+
+/*
+ * call-seq:
+ *   V8::Buffer.new(length)              => new_buffer
+ *   V8::Buffer.new(length, type)        => new_buffer
+ *   V8::Buffer.new(str)                 => new_buffer
+ *   V8::Buffer.new(str, type)           => new_buffer
+ *
+ * Returns new typed buffer with given number of zeroed elements, or filled
+ * with binary contents of given string. Buffer's memory is owned by ruby,
+ * and javascript reads and writes it in place, without any conversion.
+ * Available types are: <code>:int8</code>, <code>:uint8</code> (default),
+ * <code>:int16</code>, <code>:uint16</code>, <code>:int32</code>,
+ * <code>:uint32</code> and <code>:float</code>.
+ *
+ *   buf = V8::Buffer.new(File.read("image.png"))
+ *   cxt[:image] = buf
+ *   cxt.eval("checksum(image)", "<eval>")
+ *
+ */
+static VALUE rb_v8_buffer_new(int argc, VALUE *argv, VALUE klass)
+{
+  HandleScope scope;
+  PREVENT_CREATION_WITHOUT_CONTEXT();
+
+  if (argc < 1 || argc > 2) {
+    rb_raise(rb_eArgError, "wrong number of arguments (%d for 1..2)", argc);
+    return Qnil;
+  }
+
+  v8_buffer_type *type = argc > 1 ? v8_buffer_type_by_name(argv[1]) : &buffer_types[1];
+  VALUE data;
+  long length;
+
+  if (TYPE(argv[0]) == T_STRING) {
+    length = RSTRING_LEN(argv[0]) / type->size;
+  } else {
+    length = NUM2LONG(argv[0]);
+  }
+
+  // V8 takes length of external array as an int, so byte size of the
+  // data fits in an int as well...
+  if (length < 0) {
+    rb_raise(rb_eArgError, "negative buffer length");
+    return Qnil;
+  } else if (length > INT_MAX / type->size) {
+    rb_raise(rb_eArgError, "buffer length too big (maximum is %d)", (int)(INT_MAX / type->size));
+    return Qnil;
+  }
+
+  if (TYPE(argv[0]) == T_STRING) {
+    data = rb_str_new(RSTRING_PTR(argv[0]), length * type->size);
+  } else {
+    data = rb_str_new(NULL, length * type->size);
+    memset(RSTRING_PTR(data), 0, length * type->size);
+  }
+
+  // Data string is private, so nobody will resize it and move its contents
+  // while javascript is using it.
+  Local<Object> obj = Object::New();
+  obj->SetIndexedPropertiesToExternalArrayData(RSTRING_PTR(data), type->type, (int)length);
+  obj->Set(String::NewSymbol("length"), Integer::New((int32_t)length), PropertyAttribute(ReadOnly | DontEnum | DontDelete));
+  v8_retain_ruby(obj, data);
+
+  VALUE self = rb_v8_wrapper_new(klass, obj);
+  v8_set_peer(self);
+  return self;
+}
+
+/*
+ * call-seq:
+ *   buf.type  => symbol
+ *
+ * Returns type of buffer's elements.
+ *
+ */
+static VALUE rb_v8_buffer_type(VALUE self)
+{
+  HandleScope scope;
+  return ID2SYM(rb_intern(v8_buffer_type_of(unwrap(self))->name));
+}
+
+/*
+ * call-seq:
+ *   buf.length  => int
+ *   buf.size    => int
+ *
+ * Returns number of buffer's elements.
+ *
+ */
+static VALUE rb_v8_buffer_length(VALUE self)
+{
+  HandleScope scope;
+  return INT2NUM(unwrap(self)->GetIndexedPropertiesExternalArrayDataLength());
+}
+
+/*
+ * call-seq:
+ *   buf.bytesize  => int
+ *
+ * Returns size of buffer's data in bytes.
+ *
+ */
+static VALUE rb_v8_buffer_bytesize(VALUE self)
+{
+  HandleScope scope;
+  Local<Object> obj = unwrap(self);
+  return INT2NUM(obj->GetIndexedPropertiesExternalArrayDataLength() * v8_buffer_type_of(obj)->size);
+}
+
+/*
+ * call-seq:
+ *   buf.to_s  => str
+ *
+ * Returns copy of buffer's binary data.
+ *
+ */
+static VALUE rb_v8_buffer_to_s(VALUE self)
+{
+  HandleScope scope;
+  Local<Object> obj = unwrap(self);
+  long size = obj->GetIndexedPropertiesExternalArrayDataLength() * v8_buffer_type_of(obj)->size;
+  return rb_str_new((char*)obj->GetIndexedPropertiesExternalArrayData(), size);
+}
+
+/* Public constructors */
+
+VALUE rb_v8_buffer_new2(VALUE data, VALUE type)
+{
+  VALUE args[2] = { data, type };
+  return rb_v8_buffer_new(2, args, rb_cV8Buffer);
+}
+
+
+/* V8::Buffer initializer. */
+void Init_V8_Buffer()
+{
+  rb_cV8Buffer = rb_define_class_under(rb_mV8, "Buffer", rb_cV8Object);
+  rb_define_singleton_method(rb_cV8Buffer, "new", RUBY_METHOD_FUNC(rb_v8_buffer_new), -1);
+  rb_define_method(rb_cV8Buffer, "type", RUBY_METHOD_FUNC(rb_v8_buffer_type), 0);
+  rb_define_method(rb_cV8Buffer, "length", RUBY_METHOD_FUNC(rb_v8_buffer_length), 0);
+  rb_define_method(rb_cV8Buffer, "size", RUBY_METHOD_FUNC(rb_v8_buffer_length), 0);
+  rb_define_method(rb_cV8Buffer, "bytesize", RUBY_METHOD_FUNC(rb_v8_buffer_bytesize), 0);
+  rb_define_method(rb_cV8Buffer, "to_s", RUBY_METHOD_FUNC(rb_v8_buffer_to_s), 0);
+}
@@ -0,0 +1,15 @@
+#ifndef __V8_BUFFER_H
+#define __V8_BUFFER_H
+
+#include "v8_main.h"
+
+using namespace v8;
+
+/* V8::Buffer class */
+RUBY_EXTERN VALUE rb_cV8Buffer;
+
+/* API */
+VALUE rb_v8_buffer_new2(VALUE data, VALUE type);
+void Init_V8_Buffer();
+
+#endif//__V8_BUFFER_H
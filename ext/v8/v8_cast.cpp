@@ -8,6 +8,7 @@
 #include "v8_number.h"
 #include "v8_date.h"
 #include "v8_array.h"
+#include "v8_buffer.h"
 #include "v8_function.h"
 #include "v8_regexp.h"
 #include "v8_context.h"
@@ -38,17 +39,17 @@ Handle<Value> to_v8(VALUE value)
   case T_SYMBOL:
     return to_v8(rb_sym_to_s(value));
   case T_FIXNUM:
-    return to_v8(rb_v8_integer_new2(value));
+    return scope.Close(to_v8_integer(value));
   case T_FLOAT:
-    return to_v8(rb_v8_number_new2(value));
+    return scope.Close(to_v8_number(value));
   case T_STRING:
-    return to_v8(rb_v8_string_new2(value));
+    return scope.Close(to_v8_string(value));
   case T_REGEXP:
     return to_v8(rb_v8_regexp_new2(value));
   case T_ARRAY:
-    return to_v8(rb_v8_array_new2(value));
+    return scope.Close(to_v8_array(value));
   case T_HASH:
-    return to_v8(rb_v8_object_new2(value));
+    return scope.Close(to_v8_object(value));
   default:
     if (rb_obj_is_kind_of(value, rb_cRange)) {
       return to_v8(rb_any_to_ary(value));
@@ -69,7 +70,7 @@ Handle<Value> to_v8(VALUE value)
     } else if (rb_obj_is_kind_of(value, rb_cV8EmptyClass)) {
       return Handle<Value>();
     } else {
-      return to_v8(rb_v8_object_new2(value));
+      return scope.Close(to_v8_object(value));
     }
   }
 }
@@ -79,13 +80,13 @@ VALUE to_ruby(Handle<Value> value)
   HandleScope scope;
   
   if (value.IsEmpty()) {
-    return rb_const_get(rb_mV8, rb_intern("Empty"));
+    return rb_oV8Empty;
   } else if (value->IsUndefined()) {
-    return rb_const_get(rb_mV8, rb_intern("Undefined"));
+    return rb_oV8Undefined;
   } else if (value->IsNull()) {
-    return rb_const_get(rb_mV8, rb_intern("Null"));
+    return rb_oV8Null;
   } else if (value->IsBoolean()) {
-    return rb_const_get(rb_mV8, value->BooleanValue() ? rb_intern("True") : rb_intern("False"));
+    return value->BooleanValue() ? rb_oV8True : rb_oV8False;
   } else if (value->IsDate()) {
     return to_ruby_without_peer<Date>(value, rb_cV8Date);
   } else if (value->IsUint32() || value->IsInt32()) {
@@ -102,11 +103,13 @@ VALUE to_ruby(Handle<Value> value)
     return to_ruby_with_peer<Array>(value, rb_cV8Array);
   } else if (value->IsExternal()) {
     return to_ruby_without_peer<External>(value, rb_cV8External);
+  } else if (value->IsObject() && Object::Cast(*value)->HasIndexedPropertiesInExternalArrayData()) {
+    return to_ruby_with_peer<Object>(value, rb_cV8Buffer);
   } else if (value->IsObject()) {
     return to_ruby_with_peer<Object>(value, rb_cV8Object);
   }
 
-  return rb_const_get(rb_mV8, rb_intern("Empty"));
+  return rb_oV8Empty;
 }
 
 OVERLOAD_TO_RUBY_WITH(Boolean);
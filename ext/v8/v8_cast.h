@@ -38,14 +38,14 @@ template <class T> VALUE to_ruby_with_peer(Handle<Value> value, VALUE klass)
 {
   HandleScope scope;
   Local<T> obj = T::Cast(*value);
-  Local<Value> peer = obj->GetHiddenValue(String::NewSymbol(RUBY_PEER_ATTR));
+  VALUE peer = v8_get_peer(obj);
 
-  if (peer.IsEmpty()) {
+  if (NIL_P(peer)) {
     VALUE self = rb_v8_wrapper_new(klass, obj);
     v8_set_peer2(obj, self);
     return self;
   } else {
-    return (VALUE)External::Unwrap(peer);
+    return peer;
   }
 }
 
@@ -2,6 +2,8 @@
 #include "v8_cast.h"
 #include "v8_context.h"
 #include "v8_errors.h"
+#include "v8_script.h"
+#include "v8_json.h"
 #include "v8_macros.h"
 
 using namespace v8;
@@ -39,6 +41,7 @@ static VALUE rb_v8_context_new(VALUE klass)
 {
   HandleScope scope;
   Persistent<Context> context(Context::New());
+  v8_json_capture(context);
   VALUE self = rb_v8_context_new2(klass, context);  
   context.Dispose();
   return self;
@@ -78,23 +81,22 @@ static VALUE rb_v8_context_enter(VALUE self)
 }
 
 /*
- * call-seq:
- *   cxt.eval(source, filename)      => result
- *   cxt.evaluate(source, filename)  => result
- *
- * Evaluates given JavaScript code within current context.
- *
- *   cxt = V8::Context.new
- *   cxt.evaluate("1+1", "script.js")    # => 2
- *   cxt.evaluate("var a=1", "<eval>")   # => 1
- *   cxt.evaluate("var b=a+1", "<eval>") # => 2
+ * Context#evaluate implementation. It's kept apart, so all V8 scopes are
+ * closed before ruby jump from within the script is carried out.
  *
  */
-static VALUE rb_v8_context_evaluate(VALUE self, VALUE source, VALUE filename)
+static VALUE v8_context_evaluate_scoped(int argc, VALUE *argv, VALUE self)
 {
   HandleScope scope;
-  Local<String> _source(String::Cast(*to_v8(source)));
-  Local<String> _filename(String::Cast(*to_v8(filename)));
+
+  if (argc < 2 || argc > 3) {
+    rb_raise(rb_eArgError, "wrong number of arguments (%d for 2..3)", argc);
+    return Qnil;
+  }
+
+  Local<String> _source(String::Cast(*to_v8(argv[0])));
+  Local<String> _filename(String::Cast(*to_v8(argv[1])));
+  double timeout = argc > 2 && !NIL_P(argv[2]) ? NUM2DBL(argv[2]) : 0;
 
   rb_v8_context_enter(self);
 
@@ -102,7 +104,7 @@ static VALUE rb_v8_context_evaluate(VALUE self, VALUE source, VALUE filename)
   Local<Script> script = Script::Compile(_source, _filename);
 
   if (!try_catch.HasCaught()) {
-    Local<Value> result = script->Run();
+    Local<Value> result = v8_script_run(script, timeout);
 
     if (!try_catch.HasCaught()) {
       return to_ruby(result);
@@ -112,6 +114,65 @@ static VALUE rb_v8_context_evaluate(VALUE self, VALUE source, VALUE filename)
   return rb_v8_error_new3(try_catch);
 }
 
+/*
+ * call-seq:
+ *   cxt.eval(source, filename)               => result
+ *   cxt.evaluate(source, filename)           => result
+ *   cxt.evaluate(source, filename, timeout)  => result
+ *
+ * Evaluates given JavaScript code within current context. When timeout
+ * (in seconds) is given, then execution is terminated once it takes
+ * longer than that, and <code>V8::TimeoutError</code> is returned.
+ *
+ *   cxt = V8::Context.new
+ *   cxt.evaluate("1+1", "script.js")              # => 2
+ *   cxt.evaluate("var a=1", "<eval>")             # => 1
+ *   cxt.evaluate("var b=a+1", "<eval>")           # => 2
+ *   cxt.evaluate("while(true){}", "<eval>", 0.5)  # => #<V8::TimeoutError>
+ *
+ */
+static VALUE rb_v8_context_evaluate(int argc, VALUE *argv, VALUE self)
+{
+  VALUE result = v8_context_evaluate_scoped(argc, argv, self);
+  v8_rethrow_ruby_jump();
+  return result;
+}
+
+/*
+ * call-seq:
+ *   cxt.reset!  => cxt
+ *
+ * Replaces referenced context with fresh one, which reuses global object
+ * of the old context, so reflected global stays valid while all variables
+ * defined within old context are gone. Old context is detached and V8 gets
+ * notified about its disposal.
+ *
+ */
+static VALUE rb_v8_context_reset_bang(VALUE self)
+{
+  HandleScope scope;
+  Handle<Context> old_context = unwrap(self);
+  Handle<Object> global = old_context->Global();
+  bool entered = Context::InContext() && Context::GetEntered() == old_context;
+
+  if (entered) {
+    old_context->Exit();
+  }
+
+  old_context->DetachGlobal();
+  Persistent<Context> context(Context::New(NULL, Handle<ObjectTemplate>(), global));
+  v8_json_capture(context);
+  rb_v8_wrapper_reset(self, context);
+  context.Dispose();
+  V8::ContextDisposedNotification();
+
+  if (entered) {
+    unwrap(self)->Enter();
+  }
+
+  return self;
+}
+
 /*
  * call-seq:
  *   cxt.prototype  => obj
@@ -219,8 +280,9 @@ void Init_V8_Context()
   rb_define_singleton_method(rb_cV8Context, "entered", RUBY_METHOD_FUNC(rb_v8_context_current), 0);
   rb_define_method(rb_cV8Context, "==", RUBY_METHOD_FUNC(rb_v8_context_equals_p), 1);
   rb_define_method(rb_cV8Context, "equals?", RUBY_METHOD_FUNC(rb_v8_context_equals_p), 1);
-  rb_define_method(rb_cV8Context, "evaluate", RUBY_METHOD_FUNC(rb_v8_context_evaluate), 2);
-  rb_define_method(rb_cV8Context, "eval", RUBY_METHOD_FUNC(rb_v8_context_evaluate), 2);
+  rb_define_method(rb_cV8Context, "evaluate", RUBY_METHOD_FUNC(rb_v8_context_evaluate), -1);
+  rb_define_method(rb_cV8Context, "eval", RUBY_METHOD_FUNC(rb_v8_context_evaluate), -1);
+  rb_define_method(rb_cV8Context, "reset!", RUBY_METHOD_FUNC(rb_v8_context_reset_bang), 0);
   rb_define_method(rb_cV8Context, "prototype", RUBY_METHOD_FUNC(rb_v8_context_prototype), 0);
   rb_define_method(rb_cV8Context, "global", RUBY_METHOD_FUNC(rb_v8_context_global), 0);
   rb_define_method(rb_cV8Context, "enter", RUBY_METHOD_FUNC(rb_v8_context_enter), 0);
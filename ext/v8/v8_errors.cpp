@@ -3,6 +3,7 @@
 #include "v8_value.h"
 #include "v8_base.h"
 #include "v8_errors.h"
+#include "v8_script.h"
 #include "v8_macros.h"
 
 #include <string.h>
@@ -14,6 +15,7 @@ VALUE rb_eV8RangeError;
 VALUE rb_eV8ReferenceError;
 VALUE rb_eV8SyntaxError;
 VALUE rb_eV8TypeError;
+VALUE rb_eV8TimeoutError;
 
 /* V8::Error methods */
 
@@ -65,62 +67,349 @@ static VALUE rb_v8_error_type_error_p(VALUE self)
   return rb_obj_is_kind_of(self, rb_eV8TypeError);
 }
 
+/*
+ * call-seq:
+ *   err.timeout_error?  => true or false
+ *
+ * Returns <code>true</code> when it represents an execution terminated
+ * after exceeding its time limit.
+ *
+ */
+static VALUE rb_v8_error_timeout_error_p(VALUE self)
+{
+  return rb_obj_is_kind_of(self, rb_eV8TimeoutError);
+}
+
 /* Local helpers */
 
-VALUE rb_v8_error_message(Handle<Object> ex)
+static VALUE rb_v8_error_klass(Handle<Value> ex)
 {
   HandleScope scope;
-  String::AsciiValue error_msg(ex->Get(String::New("message")));
+
+  if (ex->IsObject()) {
+    Handle<Value> con = Handle<Object>::Cast(ex)->Get(String::NewSymbol("constructor"));
+
+    if (!con.IsEmpty() && con->IsFunction()) {
+      String::AsciiValue con_name(Handle<Function>::Cast(con)->GetName());
+      char* type = (char*)*con_name;
+
+      if (strcmp(type, "SyntaxError") == 0) {
+        return rb_eV8SyntaxError;
+      } else if (strcmp(type, "ReferenceError") == 0) {
+        return rb_eV8ReferenceError;
+      } else if (strcmp(type, "RangeError") == 0) {
+        return rb_eV8RangeError;
+      } else if (strcmp(type, "TypeError") == 0) {
+        return rb_eV8TypeError;
+      }
+    }
+  }
+
+  return rb_eV8Error;
+}
+
+static VALUE rb_v8_error_message(Handle<Value> ex, Handle<Message> msg)
+{
+  Handle<Value> message = ex;
+
+  if (ex->IsObject()) {
+    message = Handle<Object>::Cast(ex)->Get(String::NewSymbol("message"));
+  }
+
+  String::AsciiValue error_msg(message);
   return rb_str_new2(*error_msg);
 }
 
-VALUE rb_v8_error_klass(Handle<Object> ex)
+static VALUE rb_v8_error_stack_trace(Handle<Value> ex, Handle<Message> msg)
 {
-  HandleScope scope;
-  Handle<Function> con(Function::Cast(*ex->Get(String::New("constructor"))));
-
-  if (!con.IsEmpty() && !con->IsUndefined() && !con->IsNull()) {
-    String::AsciiValue con_name(con->GetName());
-    char* type = (char*)*con_name;
-
-    if (strcmp(type, "SyntaxError") == 0) {
-      return rb_eV8SyntaxError;
-    } else if (strcmp(type, "ReferenceError") == 0) {
-      return rb_eV8ReferenceError;
-    } else if (strcmp(type, "RangeError") == 0) {
-      return rb_eV8RangeError;
-    } else if (strcmp(type, "TypeError") == 0) {
-      return rb_eV8TypeError;
+  if (ex->IsObject()) {
+    Handle<Value> trace = Handle<Object>::Cast(ex)->Get(String::NewSymbol("stack"));
+
+    if (!trace.IsEmpty() && trace->IsString()) {
+      String::AsciiValue error_trace(trace);
+      return rb_str_new2(*error_trace);
     }
   }
 
-  return rb_eV8Error;
+  return Qnil;
+}
+
+static VALUE rb_v8_error_line_no(Handle<Value> ex, Handle<Message> msg)
+{
+  return msg.IsEmpty() ? Qnil : to_ruby(msg->GetLineNumber());
+}
+
+static VALUE rb_v8_error_source_line(Handle<Value> ex, Handle<Message> msg)
+{
+  return msg.IsEmpty() ? Qnil : to_ruby(msg->GetSourceLine());
+}
+
+static VALUE rb_v8_error_script_name(Handle<Value> ex, Handle<Message> msg)
+{
+  return msg.IsEmpty() ? Qnil : to_ruby(msg->GetScriptResourceName());
+}
+
+static VALUE rb_v8_error_start_col(Handle<Value> ex, Handle<Message> msg)
+{
+  return msg.IsEmpty() ? Qnil : to_ruby(msg->GetStartColumn());
+}
+
+static VALUE rb_v8_error_end_col(Handle<Value> ex, Handle<Message> msg)
+{
+  return msg.IsEmpty() ? Qnil : to_ruby(msg->GetEndColumn());
+}
+
+/*
+ * Returns value of given error attribute. Errors keep their exception and
+ * message as persistent handles, so the attribute is reflected on first
+ * access and cached in instance variable of the same name. First access
+ * has to happen within error's isolate (and V8 lock, if used), otherwise
+ * error is raised.
+ *
+ */
+static VALUE rb_v8_error_attr(VALUE self, const char *name,
+			      VALUE (*reflect)(Handle<Value> ex, Handle<Message> msg))
+{
+  ID attr = rb_intern(name);
+
+  if (rb_ivar_defined(self, attr) || TYPE(self) != T_DATA) {
+    return rb_attr_get(self, attr);
+  }
+
+  rb_sV8Wrapper *r = 0;
+  Data_Get_Struct(self, struct rb_sV8Wrapper, r);
+
+  // Handles can't be touched when owning isolate is used somewhere else,
+  // or has been already left...
+  if (r->isolate->disposed || !r->isolate->current()) {
+    rb_raise(rb_eRuntimeError, "can't reflect error details outside of its isolate or V8 lock");
+    return Qnil;
+  }
+
+  VALUE msg_ref = r->get(rb_intern("message_handle"));
+  VALUE cxt_ref = r->get(rb_intern("context_handle"));
+
+  if (NIL_P(cxt_ref) && !((Value*)*r->handle)->IsObject()) {
+    rb_raise(rb_eRuntimeError, "can't reflect error details without its context");
+    return Qnil;
+  }
+
+  HandleScope scope;
+  Handle<Value> ex((Value*)*r->handle);
+  Handle<Message> msg;
+  Handle<Context> cxt;
+
+  if (!NIL_P(msg_ref)) {
+    msg = v8_handle_from_wrapper<Message>(msg_ref);
+  }
+  if (ex->IsObject()) {
+    cxt = Handle<Object>::Cast(ex)->CreationContext();
+  } else {
+    cxt = v8_handle_from_wrapper<Context>(cxt_ref);
+  }
+
+  Context::Scope cxt_scope(cxt);
+  VALUE value = reflect(ex, msg);
+  rb_ivar_set(self, attr, value);
+  return value;
+}
+
+/* V8::Error attribute readers */
+
+/*
+ * call-seq:
+ *   err.message  => str
+ *
+ * Returns error message.
+ *
+ */
+static VALUE rb_v8_error_message_m(VALUE self)
+{
+  return rb_v8_error_attr(self, "@message", rb_v8_error_message);
+}
+
+/*
+ * call-seq:
+ *   err.stack_trace  => str or nil
+ *
+ * Returns formatted stack trace of the exception.
+ *
+ */
+static VALUE rb_v8_error_stack_trace_m(VALUE self)
+{
+  return rb_v8_error_attr(self, "@stack_trace", rb_v8_error_stack_trace);
+}
+
+/*
+ * call-seq:
+ *   err.line_no  => int
+ *
+ * Returns number of line where error occured.
+ *
+ */
+static VALUE rb_v8_error_line_no_m(VALUE self)
+{
+  return rb_v8_error_attr(self, "@line_no", rb_v8_error_line_no);
+}
+
+/*
+ * call-seq:
+ *   err.source_line  => str
+ *
+ * Returns source code of line where error occured.
+ *
+ */
+static VALUE rb_v8_error_source_line_m(VALUE self)
+{
+  return rb_v8_error_attr(self, "@source_line", rb_v8_error_source_line);
+}
+
+/*
+ * call-seq:
+ *   err.script_name  => str
+ *
+ * Returns name of script where error occured.
+ *
+ */
+static VALUE rb_v8_error_script_name_m(VALUE self)
+{
+  return rb_v8_error_attr(self, "@script_name", rb_v8_error_script_name);
+}
+
+/*
+ * call-seq:
+ *   err.start_col  => int
+ *
+ * Returns column where erroneous code starts.
+ *
+ */
+static VALUE rb_v8_error_start_col_m(VALUE self)
+{
+  return rb_v8_error_attr(self, "@start_col", rb_v8_error_start_col);
+}
+
+/*
+ * call-seq:
+ *   err.end_col  => int
+ *
+ * Returns column where erroneous code ends.
+ *
+ */
+static VALUE rb_v8_error_end_col_m(VALUE self)
+{
+  return rb_v8_error_attr(self, "@end_col", rb_v8_error_end_col);
+}
+
+/*
+ * Ruby jump which terminated javascript execution in current thread, kept
+ * until control gets back to ruby. Raised exception is kept in thread local
+ * variable as well, because error info can be overwritten by ruby code
+ * executed in the meantime.
+ *
+ */
+static __thread int pending_jump = 0;
+static ID pending_error_id;
+
+/*
+ * Passes ruby jump caught with <code>rb_protect</code> to javascript. Ruby
+ * exceptions (<code>StandardError</code>s) are rethrown as javascript
+ * errors, so scripts can handle them. Ruby exceptions can't be raised
+ * through V8 frames, so each callback from javascript to ruby has to pass
+ * them this way.
+ *
+ * All other jumps (exits, interrupts, killed threads, throws or breaks out
+ * of procs) must not be handled by javascript, so execution is terminated
+ * instead, and the jump is carried out by <code>v8_rethrow_ruby_jump</code>
+ * once control gets back to ruby.
+ *
+ */
+Handle<Value> v8_throw_ruby_error(int state)
+{
+  VALUE err = rb_errinfo();
+
+  // Jump can be carried out only from within javascript executed by us,
+  // otherwise there is no place to pick it up...
+  if ((state == TAG_RAISE && rb_obj_is_kind_of(err, rb_eStandardError)) || v8_execution_depth() == 0) {
+    VALUE msg = state == TAG_RAISE ? rb_obj_as_string(err) : rb_str_new2("non-local exit from ruby code");
+    rb_set_errinfo(Qnil);
+    return ThrowException(Exception::Error(String::New(RSTRING_PTR(msg), RSTRING_LEN(msg))));
+  }
+
+  if (pending_jump == 0) {
+    pending_jump = state;
+    rb_thread_local_aset(rb_thread_current(), pending_error_id, state == TAG_RAISE ? err : Qnil);
+  }
+
+  V8::TerminateExecution(Isolate::GetCurrent());
+  return Undefined();
+}
+
+/* Returns <code>true</code> when ruby jump is waiting to be carried out. */
+bool v8_ruby_jump_pending()
+{
+  return pending_jump != 0;
+}
+
+/*
+ * Carries out ruby jump which terminated javascript execution. It has to be
+ * called once all V8 scopes are closed, right before returning to ruby.
+ *
+ */
+void v8_rethrow_ruby_jump()
+{
+  int state = pending_jump;
+
+  if (state != 0) {
+    VALUE err = rb_thread_local_aref(rb_thread_current(), pending_error_id);
+    rb_thread_local_aset(rb_thread_current(), pending_error_id, Qnil);
+    pending_jump = 0;
+
+    if (state == TAG_RAISE) {
+      rb_exc_raise(err);
+    } else {
+      rb_jump_tag(state);
+    }
+  }
 }
 
 /* Public constructors */
 
-VALUE rb_v8_error_new2(Handle<Value> ex, Handle<Message> msg, Handle<Value> trace)
+VALUE rb_v8_error_new2(Handle<Value> ex, Handle<Message> msg)
 {
   HandleScope scope;
-  
-  Handle<Object> exc(Object::Cast(*ex));
-  VALUE err = rb_funcall2(rb_v8_error_klass(exc), rb_intern("new"), 0, NULL);
-
-  // Error class doesn't have any reflections to v8 objects, so we have to
-  // rewrite everything into its instance variables.
-  rb_iv_set(err, "@message", rb_v8_error_message(exc));
-  rb_iv_set(err, "@line_no", to_ruby(msg->GetLineNumber()));
-  rb_iv_set(err, "@source_line", to_ruby(msg->GetSourceLine()));
-  rb_iv_set(err, "@script_name", to_ruby(msg->GetScriptResourceName()));
-  rb_iv_set(err, "@start_col", to_ruby(msg->GetStartColumn()));
-  rb_iv_set(err, "@end_col", to_ruby(msg->GetEndColumn()));
-  
+
+  // Only the error class is resolved here, everything else is reflected
+  // on demand, because lots of errors are checked only with #error?...
+  VALUE err = rb_v8_wrapper_new(rb_v8_error_klass(ex), ex);
+
+  if (!msg.IsEmpty()) {
+    rb_v8_wrapper_aset(err, "message_handle", rb_v8_wrapper_new(rb_cObject, msg));
+  }
+
+  // Thrown primitives don't know their context, so it has to be kept
+  // to reflect the message later...
+  if (!ex->IsObject() && Context::InContext()) {
+    rb_v8_wrapper_aset(err, "context_handle", rb_v8_wrapper_new(rb_cObject, Context::GetCurrent()));
+  }
+
+  return err;
+}
+
+VALUE rb_v8_timeout_error_new()
+{
+  VALUE err = rb_funcall2(rb_eV8TimeoutError, rb_intern("new"), 0, NULL);
+  rb_iv_set(err, "@message", rb_str_new2("execution timed out"));
   return err;
 }
 
 VALUE rb_v8_error_new3(TryCatch try_catch)
 {
-  return rb_v8_error_new2(try_catch.Exception(), try_catch.Message(), try_catch.StackTrace());
+  // Terminated execution doesn't have any exception object to reflect...
+  if (!try_catch.CanContinue()) {
+    return rb_v8_timeout_error_new();
+  }
+
+  return rb_v8_error_new2(try_catch.Exception(), try_catch.Message());
 }
 
 
@@ -132,16 +421,18 @@ void Init_V8_Errors()
   rb_define_method(rb_eV8Error, "syntax_error?", RUBY_METHOD_FUNC(rb_v8_error_syntax_error_p), 0);
   rb_define_method(rb_eV8Error, "range_error?", RUBY_METHOD_FUNC(rb_v8_error_range_error_p), 0);
   rb_define_method(rb_eV8Error, "type_error?", RUBY_METHOD_FUNC(rb_v8_error_type_error_p), 0);
-  rb_define_attr(rb_eV8Error, "message", 1, 0);
-  rb_define_attr(rb_eV8Error, "line_no", 1, 0);
-  rb_define_attr(rb_eV8Error, "source_line", 1, 0);
-  rb_define_attr(rb_eV8Error, "script_name", 1, 0);
-  rb_define_attr(rb_eV8Error, "start_col", 1, 0);
-  rb_define_attr(rb_eV8Error, "end_col", 1, 0);
-  rb_define_attr(rb_eV8Error, "stack_trace", 1, 0);
+  rb_define_method(rb_eV8Error, "timeout_error?", RUBY_METHOD_FUNC(rb_v8_error_timeout_error_p), 0);
+  rb_define_method(rb_eV8Error, "message", RUBY_METHOD_FUNC(rb_v8_error_message_m), 0);
+  rb_define_method(rb_eV8Error, "line_no", RUBY_METHOD_FUNC(rb_v8_error_line_no_m), 0);
+  rb_define_method(rb_eV8Error, "source_line", RUBY_METHOD_FUNC(rb_v8_error_source_line_m), 0);
+  rb_define_method(rb_eV8Error, "script_name", RUBY_METHOD_FUNC(rb_v8_error_script_name_m), 0);
+  rb_define_method(rb_eV8Error, "start_col", RUBY_METHOD_FUNC(rb_v8_error_start_col_m), 0);
+  rb_define_method(rb_eV8Error, "end_col", RUBY_METHOD_FUNC(rb_v8_error_end_col_m), 0);
+  rb_define_method(rb_eV8Error, "stack_trace", RUBY_METHOD_FUNC(rb_v8_error_stack_trace_m), 0);
     
   rb_eV8RangeError = rb_define_class_under(rb_mV8, "RangeError", rb_eV8Error);
   rb_eV8ReferenceError = rb_define_class_under(rb_mV8, "ReferenceError", rb_eV8Error);
   rb_eV8SyntaxError = rb_define_class_under(rb_mV8, "SyntaxError", rb_eV8Error);
   rb_eV8TypeError = rb_define_class_under(rb_mV8, "TypeError", rb_eV8Error);
+  rb_eV8TimeoutError = rb_define_class_under(rb_mV8, "TimeoutError", rb_eV8Error);
 }
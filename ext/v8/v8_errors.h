@@ -10,10 +10,15 @@ RUBY_EXTERN VALUE rb_eV8RangeError;
 RUBY_EXTERN VALUE rb_eV8ReferenceError;
 RUBY_EXTERN VALUE rb_eV8StntaxError;
 RUBY_EXTERN VALUE rb_eV8TypeError;
+RUBY_EXTERN VALUE rb_eV8TimeoutError;
 
 /* API */
 VALUE rb_v8_error_new2(Handle<Value> ex, Handle<Message> msg);
 VALUE rb_v8_error_new3(TryCatch try_catch);
+VALUE rb_v8_timeout_error_new();
+Handle<Value> v8_throw_ruby_error(int state);
+bool v8_ruby_jump_pending();
+void v8_rethrow_ruby_jump();
 void Init_V8_Errors();
 
 #endif /* __V8_ERRORS_H */
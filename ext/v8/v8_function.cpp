@@ -4,8 +4,12 @@
 #include "v8_function.h"
 #include "v8_external.h"
 #include "v8_errors.h"
+#include "v8_script.h"
+#include "v8_locker.h"
 #include "v8_macros.h"
 
+#include <vector>
+
 using namespace v8;
 
 VALUE rb_cV8Function;
@@ -13,28 +17,142 @@ UNWRAPPER(Function);
 
 /* Typecasting */
 
+/*
+ * Descriptor of ruby proc or method exposed as javascript function. It's
+ * built once, when function is created, so each call from javascript can go
+ * straight to the proc without asking it for arity or looking up methods.
+ * Descriptor is owned by ruby object, retained as long as function lives.
+ *
+ */
+struct v8_callback {
+  VALUE proc;
+  int arity;
+  enum { CALL_PROC, CALL_METHOD, CALL_ANY } kind;
+};
+
+static void v8_callback_gc_mark(v8_callback *cb)
+{
+  rb_gc_mark(cb->proc);
+}
+
+static void v8_callback_gc_free(v8_callback *cb)
+{
+  delete cb;
+}
+
+static VALUE v8_callback_new(VALUE proc, v8_callback **cb)
+{
+  *cb = new v8_callback();
+  (*cb)->proc = proc;
+  (*cb)->kind = v8_callback::CALL_ANY;
+
+  // We have to invoke `arity` on given proc instead of calling rb_proc_arity,
+  // because we can have instance of Method instead of Proc...
+  (*cb)->arity = FIX2INT(rb_funcall2(proc, rb_intern("arity"), 0, NULL));
+
+#ifdef HAVE_RB_PROC_CALL_WITH_BLOCK
+  if (rb_obj_is_proc(proc)) {
+    (*cb)->kind = v8_callback::CALL_PROC;
+  }
+#endif
+#ifdef HAVE_RB_METHOD_CALL
+  if (rb_obj_is_kind_of(proc, rb_cMethod)) {
+    (*cb)->kind = v8_callback::CALL_METHOD;
+  }
+#endif
+
+  return Data_Wrap_Struct(rb_cObject, v8_callback_gc_mark, v8_callback_gc_free, *cb);
+}
+
+static VALUE v8_callback_call(v8_callback *cb, int argc, VALUE *argv)
+{
+  switch (cb->kind) {
+#ifdef HAVE_RB_PROC_CALL_WITH_BLOCK
+  case v8_callback::CALL_PROC:
+    return rb_proc_call_with_block(cb->proc, argc, argv, Qnil);
+#endif
+#ifdef HAVE_RB_METHOD_CALL
+  case v8_callback::CALL_METHOD:
+    return rb_method_call(argc, argv, cb->proc);
+#endif
+  default:
+    // Again, other callables have to be invoked with `call` method...
+    return rb_funcall2(cb->proc, rb_intern("call"), argc, argv);
+  }
+}
+
+struct v8_proc_call_args {
+  const Arguments *args;
+  Handle<Value> result;
+};
+
+static VALUE v8_proc_call_protected(VALUE data)
+{
+  v8_proc_call_args *call = (v8_proc_call_args*)data;
+  const Arguments &args = *call->args;
+  v8_callback *cb = (v8_callback*)External::Unwrap(args.Data());
+  int argc = args.Length();
+
+  if (cb->arity >= 0 && cb->arity != argc) {
+    call->result = ThrowException(Exception::Error(String::New("wrong number of arguments")));
+    return Qnil;
+  }
+
+  // Most of callbacks takes only few arguments, so they're converted onto
+  // the stack, and ruby array (visible to GC) is used for the longer lists...
+  VALUE stack_args[V8_CALLBACK_STACK_ARGS];
+  VALUE heap_args = Qnil;
+  VALUE *argv = stack_args;
+
+  if (argc > V8_CALLBACK_STACK_ARGS) {
+    heap_args = rb_ary_new2(argc);
+
+    for (int i = 0; i < argc; i++) {
+      rb_ary_push(heap_args, to_ruby(args[i]));
+    }
+
+    argv = RARRAY_PTR(heap_args);
+  } else {
+    for (int i = 0; i < argc; i++) {
+      stack_args[i] = to_ruby(args[i]);
+    }
+  }
+
+  call->result = to_v8(v8_callback_call(cb, argc, argv));
+  RB_GC_GUARD(heap_args);
+  return Qnil;
+}
+
+/*
+ * Calls ruby proc, rescuing all ruby exceptions and rethrowing them as
+ * javascript errors.
+ *
+ */
+static void *v8_proc_call(void *data)
+{
+  int state = 0;
+  rb_protect(v8_proc_call_protected, (VALUE)data, &state);
+
+  if (state) {
+    ((v8_proc_call_args*)data)->result = v8_throw_ruby_error(state);
+  }
+
+  return NULL;
+}
+
 static Handle<Value> proc_caller(const Arguments &args)
 {
   HandleScope scope;
 
   if (!args.Data().IsEmpty() && args.Data()->IsExternal()) {
-    VALUE proc = (VALUE)External::Cast(*args.Data())->Value();
-    VALUE proc_args[args.Length()];
-
-    // We have to invoke `arity` on given proc instead of calling rb_proc_arity,
-    // because we can have instance of Method instead of Proc...
-    int proc_arity = FIX2INT(rb_funcall2(proc, rb_intern("arity"), 0, NULL));
-    
-    if (proc_arity < 0 || proc_arity == args.Length()) {
-      for (int i = 0; i < args.Length(); i++) {
-	proc_args[i] = to_ruby(args[i]);
-      }
+    v8_proc_call_args call;
+    call.args = &args;
+    call.result = Null();
 
-      // Again, we have to invoke `call` method like this instead of rb_proc_call...
-      return to_v8(rb_funcall2(proc, rb_intern("call"), args.Length(), proc_args));
-    } else {
-      ThrowException(Exception::Error(String::New("wrong number of arguments")));
-    }
+    // When javascript is executed without GVL then we have to get it back
+    // before touching any ruby stuff...
+    rb_v8_with_gvl(v8_proc_call, &call);
+    return scope.Close(call.result);
   }
 
   return Null();
@@ -43,8 +161,70 @@ static Handle<Value> proc_caller(const Arguments &args)
 Handle<Value> to_v8_function(VALUE value)
 {
   HandleScope scope;
-  Handle<FunctionTemplate> func = FunctionTemplate::New(proc_caller, to_v8_external(value));
-  return func->GetFunction();
+  v8_callback *cb;
+  VALUE descriptor = v8_callback_new(value, &cb);
+  Handle<FunctionTemplate> tpl = FunctionTemplate::New(proc_caller, External::New(cb));
+  Local<Function> func = tpl->GetFunction();
+  v8_retain_ruby(func, descriptor);
+  return scope.Close(func);
+}
+
+struct v8_function_call_args {
+  Handle<Function> func;
+  Handle<Object> recv;
+  int argc;
+  Handle<Value> *argv;
+  Handle<Value> result;
+};
+
+static void *v8_function_call_nogvl(void *data)
+{
+  v8_function_call_args *call = (v8_function_call_args*)data;
+  call->result = call->func->Call(call->recv, call->argc, call->argv);
+  return NULL;
+}
+
+/*
+ * Batch of calls performed by <code>call_many</code> with single release
+ * of GVL. Arguments of all calls are flattened into one list, and outcome
+ * of each call is kept until it's converted back with GVL.
+ *
+ */
+struct v8_function_batch {
+  Handle<Function> func;
+  Handle<Object> recv;
+  std::vector<int> argcs;
+  std::vector< Handle<Value> > argv;
+  std::vector< Handle<Value> > results;
+  std::vector< Handle<Value> > exceptions;
+  std::vector< Handle<Message> > messages;
+  bool terminated;
+};
+
+static void *v8_function_call_batch_nogvl(void *data)
+{
+  v8_function_batch *batch = (v8_function_batch*)data;
+  size_t offset = 0;
+
+  for (size_t i = 0; i < batch->argcs.size(); i++) {
+    TryCatch try_catch;
+    int argc = batch->argcs[i];
+    Handle<Value> result = batch->func->Call(batch->recv, argc, argc > 0 ? &batch->argv[offset] : NULL);
+    offset += argc;
+
+    // Terminated execution can't be continued, so the rest of calls is
+    // skipped...
+    if (try_catch.HasCaught() && !try_catch.CanContinue()) {
+      batch->terminated = true;
+      break;
+    }
+
+    batch->results.push_back(result);
+    batch->exceptions.push_back(try_catch.Exception());
+    batch->messages.push_back(try_catch.Message());
+  }
+
+  return NULL;
 }
 
 /* V8::Function methods */
@@ -85,14 +265,11 @@ static VALUE rb_v8_function_new(int argc, VALUE *argv, VALUE klass)
 }
 
 /*
- * call-seq:
- *   func.call_on(recv, *args)  => result
- *
- * Executes function with given arguments on specified receiver. When function code is
- * broken then proper JavaScript error will be returned. 
+ * Function#call_on implementation. It's kept apart, so all V8 scopes are
+ * closed before ruby jump from within the function is carried out.
  *
  */
-static VALUE rb_v8_function_call_on(int argc, VALUE *argv, VALUE self)
+static VALUE v8_function_call_on_scoped(int argc, VALUE *argv, VALUE self)
 {
   HandleScope scope;
   TryCatch try_catch;
@@ -114,7 +291,13 @@ static VALUE rb_v8_function_call_on(int argc, VALUE *argv, VALUE self)
     args[i-1] = to_v8(argv[i]);
   }
   
-  Handle<Value> result = unwrap(self)->Call(this_obj, argc-1, args);
+  v8_function_call_args call;
+  call.func = unwrap(self);
+  call.recv = this_obj;
+  call.argc = argc-1;
+  call.argv = args;
+  v8_execute(v8_function_call_nogvl, &call);
+  Handle<Value> result = call.result;
 
   if (try_catch.HasCaught()) {
     return rb_v8_error_new3(try_catch);
@@ -123,6 +306,125 @@ static VALUE rb_v8_function_call_on(int argc, VALUE *argv, VALUE self)
   }
 }
 
+/*
+ * call-seq:
+ *   func.call_on(recv, *args)  => result
+ *
+ * Executes function with given arguments on specified receiver. When function code is
+ * broken then proper JavaScript error will be returned. 
+ *
+ */
+static VALUE rb_v8_function_call_on(int argc, VALUE *argv, VALUE self)
+{
+  VALUE result = v8_function_call_on_scoped(argc, argv, self);
+  v8_rethrow_ruby_jump();
+  return result;
+}
+
+/* Converts arguments of single tuple to the end of the batch. */
+static VALUE v8_function_batch_push(VALUE data)
+{
+  VALUE *args = (VALUE*)data;
+  v8_function_batch *batch = (v8_function_batch*)args[0];
+  VALUE tuple = args[1];
+  size_t offset = batch->argv.size();
+
+  if (TYPE(tuple) == T_ARRAY) {
+    for (long j = 0; j < RARRAY_LEN(tuple); j++) {
+      batch->argv.push_back(to_v8(rb_ary_entry(tuple, j)));
+    }
+  } else {
+    batch->argv.push_back(to_v8(tuple));
+  }
+
+  batch->argcs.push_back(batch->argv.size() - offset);
+  return Qnil;
+}
+
+/*
+ * Function#call_many implementation. It's kept apart, so all V8 scopes are
+ * closed before ruby jump from within the function is carried out. Tuple
+ * conversions can raise as well, so they're protected and state of failed
+ * one is passed out to be rethrown there.
+ *
+ */
+static VALUE v8_function_call_many_scoped(VALUE self, VALUE recv, VALUE tuples, int *state)
+{
+  HandleScope scope;
+  Check_Type(tuples, T_ARRAY);
+
+  Handle<Object> this_obj =
+    NIL_P(recv) ? Context::GetEntered()->Global() :
+    unwrap(recv)->ToObject();
+
+  VALUE results = rb_ary_new2(RARRAY_LEN(tuples));
+  bool terminated = false;
+
+  for (long start = 0; start < RARRAY_LEN(tuples) && !terminated && *state == 0; start += V8_FUNCTION_CALL_BATCH_SIZE) {
+    HandleScope batch_scope;
+    v8_function_batch batch;
+    batch.func = unwrap(self);
+    batch.recv = this_obj;
+    batch.terminated = false;
+
+    for (long i = start; i < start + V8_FUNCTION_CALL_BATCH_SIZE && i < RARRAY_LEN(tuples) && *state == 0; i++) {
+      VALUE args[2] = { (VALUE)&batch, rb_ary_entry(tuples, i) };
+      rb_protect(v8_function_batch_push, (VALUE)args, state);
+    }
+
+    if (*state != 0) {
+      break;
+    }
+
+    v8_execute(v8_function_call_batch_nogvl, &batch);
+
+    for (size_t i = 0; i < batch.results.size(); i++) {
+      if (batch.exceptions[i].IsEmpty()) {
+        rb_ary_push(results, to_ruby(batch.results[i]));
+      } else {
+        rb_ary_push(results, rb_v8_error_new2(batch.exceptions[i], batch.messages[i]));
+      }
+    }
+
+    if (batch.terminated) {
+      rb_ary_push(results, rb_v8_timeout_error_new());
+      terminated = true;
+    }
+  }
+
+  return results;
+}
+
+/*
+ * call-seq:
+ *   func.call_many(recv, tuples)  => results
+ *
+ * Executes function on specified receiver once for each given tuple of
+ * arguments (single non-array value is passed as the only argument), and
+ * returns array of results. Calls are performed in batches, sharing handle
+ * scopes and crossing between ruby and javascript once per batch. Broken
+ * calls don't stop the others, and proper JavaScript errors are returned in
+ * place of their results. When execution is terminated (eg. by timeout of
+ * outer script which called back to ruby) then <code>V8::TimeoutError</code>
+ * is the last result and remaining calls are skipped.
+ *
+ *   func = cxt.eval("(function(a, b) { return a + b })", "<eval>")
+ *   func.call_many(nil, [[1, 2], [3, 4]]) # => [3, 7]
+ *
+ */
+static VALUE rb_v8_function_call_many(VALUE self, VALUE recv, VALUE tuples)
+{
+  int state = 0;
+  VALUE result = v8_function_call_many_scoped(self, recv, tuples, &state);
+  v8_rethrow_ruby_jump();
+
+  if (state != 0) {
+    rb_jump_tag(state);
+  }
+
+  return result;
+}
+
 /*
  * call-seq:
  *   func.name  => str
@@ -178,6 +480,7 @@ void Init_V8_Function()
   rb_define_singleton_method(rb_cV8Function, "new", RUBY_METHOD_FUNC(rb_v8_function_new), -1);
   rb_define_method(rb_cV8Function, "bind", RUBY_METHOD_FUNC(rb_v8_function_bind), 1);
   rb_define_method(rb_cV8Function, "call_on", RUBY_METHOD_FUNC(rb_v8_function_call_on), -1);
+  rb_define_method(rb_cV8Function, "call_many", RUBY_METHOD_FUNC(rb_v8_function_call_many), 2);
   rb_define_method(rb_cV8Function, "name", RUBY_METHOD_FUNC(rb_v8_function_get_name), 0);
   rb_define_method(rb_cV8Function, "name=", RUBY_METHOD_FUNC(rb_v8_function_set_name), 1);
   rb_define_attr(rb_cV8Function, "receiver", 1, 0);
@@ -3,6 +3,12 @@
 
 #include "v8_main.h"
 
+/* Number of calls performed by V8::Function#call_many per batch. */
+#define V8_FUNCTION_CALL_BATCH_SIZE 256
+
+/* Number of arguments passed to ruby callbacks without allocation. */
+#define V8_CALLBACK_STACK_ARGS 8
+
 /* V8::Function class */
 RUBY_EXTERN VALUE rb_cV8Function;
 
@@ -0,0 +1,263 @@
+#include "v8_main.h"
+#include "v8_ref.h"
+#include "v8_heap.h"
+#include "v8_macros.h"
+
+#include <pthread.h>
+#include <time.h>
+#include <limits.h>
+
+using namespace v8;
+
+/* Collected statistics of single type of garbage collections. */
+struct v8_gc_stats {
+  long count;
+  double pause_total;
+  double pause_max;
+  double pause_last;
+};
+
+/*
+ * GC callbacks are called within V8's GC, possibly without GVL and from
+ * different threads (each isolate collects its own heap), so they can't
+ * touch ruby, and statistics are guarded with mutex.
+ *
+ */
+static v8_gc_stats scavenge_stats = { 0, 0, 0, 0 };
+static v8_gc_stats mark_sweep_stats = { 0, 0, 0, 0 };
+static pthread_mutex_t gc_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread double gc_started_at = 0;
+
+/* Local helpers */
+
+static double v8_monotonic_time()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void v8_gc_prologue(GCType type, GCCallbackFlags flags)
+{
+  gc_started_at = v8_monotonic_time();
+}
+
+static void v8_gc_epilogue(GCType type, GCCallbackFlags flags)
+{
+  double pause = v8_monotonic_time() - gc_started_at;
+  v8_gc_stats *stats = type == kGCTypeScavenge ? &scavenge_stats : &mark_sweep_stats;
+
+  pthread_mutex_lock(&gc_stats_mutex);
+  stats->count++;
+  stats->pause_total += pause;
+  stats->pause_last = pause;
+
+  if (pause > stats->pause_max) {
+    stats->pause_max = pause;
+  }
+
+  pthread_mutex_unlock(&gc_stats_mutex);
+}
+
+static VALUE v8_gc_stats_to_hash(v8_gc_stats *stats)
+{
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, ID2SYM(rb_intern("count")), LONG2NUM(stats->count));
+  rb_hash_aset(hash, ID2SYM(rb_intern("pause_total")), rb_float_new(stats->pause_total));
+  rb_hash_aset(hash, ID2SYM(rb_intern("pause_max")), rb_float_new(stats->pause_max));
+  rb_hash_aset(hash, ID2SYM(rb_intern("pause_last")), rb_float_new(stats->pause_last));
+  return hash;
+}
+
+static int v8_constraint(VALUE opts, const char *name)
+{
+  VALUE value = rb_hash_aref(opts, ID2SYM(rb_intern(name)));
+
+  if (NIL_P(value)) {
+    return 0;
+  }
+
+  // V8 takes all limits as ints, so bigger values can't be passed...
+  if (!rb_obj_is_kind_of(value, rb_cInteger) ||
+      RTEST(rb_funcall(value, rb_intern("<"), 1, INT2FIX(0))) ||
+      RTEST(rb_funcall(value, rb_intern(">"), 1, INT2NUM(INT_MAX)))) {
+    rb_raise(rb_eArgError, "invalid :%s constraint (expected integer between 0 and %d)", name, INT_MAX);
+  }
+
+  return NUM2INT(value);
+}
+
+/* V8 heap singleton methods. */
+
+/*
+ * call-seq:
+ *   V8.set_resource_constraints(opts)  => true or false
+ *
+ * Limits resources available for current isolate. Following options (in
+ * bytes) are accepted:
+ *
+ * * <code>:max_young_space</code> - maximal size of new space,
+ * * <code>:max_old_space</code> - maximal size of old generation,
+ * * <code>:max_executable</code> - maximal size of compiled code,
+ * * <code>:stack_limit</code> - maximal size of javascript stack, counted
+ *   from current position of stack in the calling thread.
+ *
+ * Each limit has to be a non-negative integer which fits in an int (so it
+ * can't exceed 2GB), otherwise <code>ArgumentError</code> is raised. Heap
+ * sizes can be set only before heap of isolate has been set up (eg.
+ * before first context is created within it), otherwise <code>false</code>
+ * is returned.
+ *
+ *   iso = V8::Isolate.new
+ *   iso.enter { V8.set_resource_constraints(:max_old_space => 64 << 20) }
+ *
+ */
+static VALUE rb_v8_set_resource_constraints(VALUE self, VALUE opts)
+{
+  Check_Type(opts, T_HASH);
+
+  ResourceConstraints constraints;
+  constraints.set_max_young_space_size(v8_constraint(opts, "max_young_space"));
+  constraints.set_max_old_space_size(v8_constraint(opts, "max_old_space"));
+  constraints.set_max_executable_size(v8_constraint(opts, "max_executable"));
+
+  int stack_size = v8_constraint(opts, "stack_limit");
+
+  if (stack_size > 0) {
+    // Stack grows down, so limit lays below current position...
+    uint32_t marker;
+    constraints.set_stack_limit((uint32_t*)((char*)&marker - stack_size));
+  }
+
+  return SetResourceConstraints(&constraints) ? Qtrue : Qfalse;
+}
+
+/*
+ * call-seq:
+ *   V8.idle_notification  => true or false
+ *
+ * Tells V8 that embedder is idle, so it can perform some cleanup work.
+ * Returns <code>true</code> when there is nothing more to clean up, and
+ * further notifications are not needed until next javascript execution.
+ *
+ */
+static VALUE rb_v8_idle_notification(VALUE self)
+{
+  return V8::IdleNotification() ? Qtrue : Qfalse;
+}
+
+/*
+ * call-seq:
+ *   V8.low_memory_notification  => nil
+ *
+ * Tells V8 that system is running low on memory, so it performs full
+ * garbage collection and frees as much memory as it can.
+ *
+ */
+static VALUE rb_v8_low_memory_notification(VALUE self)
+{
+  V8::LowMemoryNotification();
+  return Qnil;
+}
+
+/*
+ * call-seq:
+ *   V8.heap_statistics  => hash
+ *
+ * Returns sizes (in bytes) of current isolate's heap:
+ *
+ *   V8.heap_statistics # => {:total_heap_size => 1867776, :total_heap_size_executable => 262144,
+ *                      #     :used_heap_size => 1012688, :heap_size_limit => 734003200}
+ *
+ */
+static VALUE rb_v8_heap_statistics(VALUE self)
+{
+  HeapStatistics stats;
+  V8::GetHeapStatistics(&stats);
+
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, ID2SYM(rb_intern("total_heap_size")), SIZET2NUM(stats.total_heap_size()));
+  rb_hash_aset(hash, ID2SYM(rb_intern("total_heap_size_executable")), SIZET2NUM(stats.total_heap_size_executable()));
+  rb_hash_aset(hash, ID2SYM(rb_intern("used_heap_size")), SIZET2NUM(stats.used_heap_size()));
+  rb_hash_aset(hash, ID2SYM(rb_intern("heap_size_limit")), SIZET2NUM(stats.heap_size_limit()));
+  return hash;
+}
+
+/*
+ * call-seq:
+ *   V8.track_gc  => nil
+ *
+ * Installs GC hooks within current isolate, so number and pause times
+ * of its garbage collections are recorded (see <code>V8.gc_statistics</code>).
+ * Hooks have to be installed separately in each isolate.
+ *
+ */
+static VALUE rb_v8_track_gc(VALUE self)
+{
+  V8::RemoveGCPrologueCallback(v8_gc_prologue);
+  V8::RemoveGCEpilogueCallback(v8_gc_epilogue);
+  V8::AddGCPrologueCallback(v8_gc_prologue);
+  V8::AddGCEpilogueCallback(v8_gc_epilogue);
+  return Qnil;
+}
+
+/*
+ * call-seq:
+ *   V8.gc_statistics  => hash
+ *
+ * Returns number of garbage collections recorded since tracking has been
+ * enabled with <code>V8.track_gc</code>, and their pause times (in seconds),
+ * by collection type:
+ *
+ *   V8.gc_statistics # => {:scavenge => {:count => 12, :pause_total => 0.0041,
+ *                    #     :pause_max => 0.0008, :pause_last => 0.0003},
+ *                    #     :mark_sweep_compact => {...}}
+ *
+ */
+static VALUE rb_v8_gc_statistics(VALUE self)
+{
+  pthread_mutex_lock(&gc_stats_mutex);
+  v8_gc_stats scavenge = scavenge_stats;
+  v8_gc_stats mark_sweep = mark_sweep_stats;
+  pthread_mutex_unlock(&gc_stats_mutex);
+
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, ID2SYM(rb_intern("scavenge")), v8_gc_stats_to_hash(&scavenge));
+  rb_hash_aset(hash, ID2SYM(rb_intern("mark_sweep_compact")), v8_gc_stats_to_hash(&mark_sweep));
+  return hash;
+}
+
+/*
+ * call-seq:
+ *   V8.wrapper_statistics  => hash
+ *
+ * Returns numbers of live ruby wrappers of V8 objects, V8 objects linked
+ * with their ruby peers, and ruby objects retained by V8 heaps.
+ *
+ *   V8.wrapper_statistics # => {:wrappers => 120, :peers => 35, :retained => 4}
+ *
+ */
+static VALUE rb_v8_wrapper_statistics(VALUE self)
+{
+  rb_sV8WrapperStats stats;
+  v8_wrapper_stats(&stats);
+
+  VALUE hash = rb_hash_new();
+  rb_hash_aset(hash, ID2SYM(rb_intern("wrappers")), LONG2NUM(stats.wrappers));
+  rb_hash_aset(hash, ID2SYM(rb_intern("peers")), LONG2NUM(stats.peers));
+  rb_hash_aset(hash, ID2SYM(rb_intern("retained")), LONG2NUM(stats.retained));
+  return hash;
+}
+
+
+/* V8 heap initializer. */
+void Init_V8_Heap()
+{
+  rb_define_singleton_method(rb_mV8, "set_resource_constraints", RUBY_METHOD_FUNC(rb_v8_set_resource_constraints), 1);
+  rb_define_singleton_method(rb_mV8, "idle_notification", RUBY_METHOD_FUNC(rb_v8_idle_notification), 0);
+  rb_define_singleton_method(rb_mV8, "low_memory_notification", RUBY_METHOD_FUNC(rb_v8_low_memory_notification), 0);
+  rb_define_singleton_method(rb_mV8, "heap_statistics", RUBY_METHOD_FUNC(rb_v8_heap_statistics), 0);
+  rb_define_singleton_method(rb_mV8, "track_gc", RUBY_METHOD_FUNC(rb_v8_track_gc), 0);
+  rb_define_singleton_method(rb_mV8, "gc_statistics", RUBY_METHOD_FUNC(rb_v8_gc_statistics), 0);
+  rb_define_singleton_method(rb_mV8, "wrapper_statistics", RUBY_METHOD_FUNC(rb_v8_wrapper_statistics), 0);
+}
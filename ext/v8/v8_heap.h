@@ -0,0 +1,11 @@
+#ifndef __V8_HEAP_H
+#define __V8_HEAP_H
+
+#include "v8_main.h"
+
+using namespace v8;
+
+/* API */
+void Init_V8_Heap();
+
+#endif//__V8_HEAP_H
@@ -0,0 +1,431 @@
+#include "v8_ref.h"
+#include "v8_string.h"
+#include "v8_isolate.h"
+#include "v8_heap_snapshot.h"
+#include "v8_macros.h"
+
+#include <v8-profiler.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+using namespace v8;
+
+VALUE rb_cV8HeapSnapshot;
+
+/* Label of native group which gathers all objects wrapped by ruby. */
+#define V8_WRAPPERS_LABEL "(Mustang wrappers)"
+
+/*
+ * Heap snapshot taken from ruby. Snapshots are owned by profiler of the
+ * isolate they were taken in, so the isolate is kept here as well.
+ *
+ */
+struct rb_sV8HeapSnapshot {
+  const HeapSnapshot *snapshot;
+  rb_sV8Isolate *isolate;
+};
+
+/* Statistics of group of heap nodes. */
+struct v8_heap_stats {
+  v8_heap_stats() : count(0), self_size(0), retained_size(0) {}
+  long count;
+  long self_size;
+  long retained_size;
+};
+
+typedef std::map<std::string, v8_heap_stats> v8_heap_stats_map;
+typedef void (*v8_heap_node_func)(const HeapGraphNode *node, void *data);
+
+/*
+ * Groups all handles tagged with wrapper class id into single native node
+ * of the snapshot, so objects kept alive by ruby wrappers can be found.
+ *
+ */
+class v8_wrappers_info : public RetainedObjectInfo {
+ public:
+  virtual void Dispose() { delete this; }
+  virtual bool IsEquivalent(RetainedObjectInfo *other) { return strcmp(other->GetLabel(), GetLabel()) == 0; }
+  virtual intptr_t GetHash() { return V8_WRAPPER_CLASS_ID; }
+  virtual const char *GetLabel() { return V8_WRAPPERS_LABEL; }
+};
+
+static RetainedObjectInfo *v8_wrappers_info_new(uint16_t class_id, Handle<Value> wrapper)
+{
+  return new v8_wrappers_info();
+}
+
+void rb_v8_heap_snapshot_free(rb_sV8HeapSnapshot *snap)
+{
+  // Snapshots of disposed isolate are already gone, and the ones owned by
+  // isolate which can't be touched now will be freed together with it...
+  if (snap->snapshot != NULL && !snap->isolate->disposed && snap->isolate->current()) {
+    const_cast<HeapSnapshot*>(snap->snapshot)->Delete();
+  }
+
+  snap->isolate->release(Persistent<void>());
+  delete snap;
+}
+
+static const HeapSnapshot *unwrap(VALUE self)
+{
+  rb_sV8HeapSnapshot *snap = 0;
+  Data_Get_Struct(self, struct rb_sV8HeapSnapshot, snap);
+
+  if (snap->snapshot == NULL || snap->isolate->disposed) {
+    rb_raise(rb_eRuntimeError, "heap snapshot has been deleted");
+  } else if (!snap->isolate->current()) {
+    rb_raise(rb_eRuntimeError, "heap snapshot can be used only within its isolate");
+  }
+
+  return snap->snapshot;
+}
+
+/* Local helpers */
+
+/*
+ * Returns name of group given node belongs to. Objects are grouped by their
+ * constructors, and other nodes by their types. Hidden nodes are skipped,
+ * so empty name is returned for them.
+ *
+ */
+static std::string v8_heap_node_group(const HeapGraphNode *node)
+{
+  switch (node->GetType()) {
+  case HeapGraphNode::kObject:
+  case HeapGraphNode::kNative:
+    return *String::Utf8Value(node->GetName());
+  case HeapGraphNode::kArray:
+    return "(array)";
+  case HeapGraphNode::kString:
+    return "(string)";
+  case HeapGraphNode::kCode:
+    return "(code)";
+  case HeapGraphNode::kClosure:
+    return "(closure)";
+  case HeapGraphNode::kRegExp:
+    return "(regexp)";
+  case HeapGraphNode::kHeapNumber:
+    return "(number)";
+  default:
+    return "";
+  }
+}
+
+/* Calls given function for each node reachable from root of snapshot. */
+static void v8_heap_each_node(const HeapSnapshot *snapshot, v8_heap_node_func func, void *data)
+{
+  std::set<const HeapGraphNode*> visited;
+  std::vector<const HeapGraphNode*> pending;
+  pending.push_back(snapshot->GetRoot());
+  visited.insert(snapshot->GetRoot());
+
+  while (!pending.empty()) {
+    const HeapGraphNode *node = pending.back();
+    pending.pop_back();
+    func(node, data);
+
+    for (int i = 0; i < node->GetChildrenCount(); i++) {
+      const HeapGraphNode *child = node->GetChild(i)->GetToNode();
+
+      if (visited.insert(child).second) {
+        pending.push_back(child);
+      }
+    }
+  }
+}
+
+static VALUE v8_heap_stats_entry(const v8_heap_stats &stats)
+{
+  VALUE entry = rb_hash_new();
+  rb_hash_aset(entry, ID2SYM(rb_intern("count")), LONG2NUM(stats.count));
+  rb_hash_aset(entry, ID2SYM(rb_intern("self_size")), LONG2NUM(stats.self_size));
+  rb_hash_aset(entry, ID2SYM(rb_intern("retained_size")), LONG2NUM(stats.retained_size));
+  return entry;
+}
+
+static VALUE v8_heap_group_name(const std::string &group)
+{
+  return v8_set_utf8_encoding(rb_str_new(group.data(), group.size()));
+}
+
+static void v8_heap_summarize_node(const HeapGraphNode *node, void *data)
+{
+  std::string group = v8_heap_node_group(node);
+
+  if (group.empty()) {
+    return;
+  }
+
+  v8_heap_stats &stats = (*(v8_heap_stats_map*)data)[group];
+  stats.count++;
+  stats.self_size += node->GetSelfSize();
+
+  // Nested objects of the same kind (eg. linked lists) would be counted many
+  // times, so only the outermost ones are taken into account...
+  const HeapGraphNode *dominator = node->GetDominatorNode();
+
+  if (dominator == NULL || v8_heap_node_group(dominator) != group) {
+    stats.retained_size += node->GetRetainedSize(false);
+  }
+}
+
+/* Nodes missing in other snapshot, grouped together with it. */
+struct v8_heap_diff {
+  const HeapSnapshot *other;
+  v8_heap_stats_map stats;
+};
+
+static void v8_heap_diff_node(const HeapGraphNode *node, void *data)
+{
+  v8_heap_diff *diff = (v8_heap_diff*)data;
+
+  if (diff->other->GetNodeById(node->GetId()) == NULL) {
+    std::string group = v8_heap_node_group(node);
+
+    if (!group.empty()) {
+      v8_heap_stats &stats = diff->stats[group];
+      stats.count++;
+      stats.self_size += node->GetSelfSize();
+    }
+  }
+}
+
+/* Returns child of given node with given name, or NULL when not found. */
+static const HeapGraphNode *v8_heap_find_child(const HeapGraphNode *node, const char *name)
+{
+  for (int i = 0; i < node->GetChildrenCount(); i++) {
+    const HeapGraphNode *child = node->GetChild(i)->GetToNode();
+
+    if (strcmp(*String::Utf8Value(child->GetName()), name) == 0) {
+      return child;
+    }
+  }
+
+  return NULL;
+}
+
+/* V8::HeapSnapshot methods */
+
+/*
+ * call-seq:
+ *   V8::HeapSnapshot.take         => snapshot
+ *   V8::HeapSnapshot.take(title)  => snapshot
+ *
+ * Takes detailed snapshot of current isolate's heap.
+ *
+ *   before = V8::HeapSnapshot.take
+ *   cxt.eval("run()", "<eval>")
+ *   V8::HeapSnapshot.take.diff(before)
+ *
+ */
+static VALUE rb_v8_heap_snapshot_take(int argc, VALUE *argv, VALUE klass)
+{
+  HandleScope scope;
+
+  if (argc > 1) {
+    rb_raise(rb_eArgError, "wrong number of arguments (%d for 0..1)", argc);
+    return Qnil;
+  }
+
+  VALUE title = argc > 0 ? StringValue(argv[0]) : rb_str_new2("");
+  HeapProfiler::DefineWrapperClass(V8_WRAPPER_CLASS_ID, v8_wrappers_info_new);
+
+  rb_sV8HeapSnapshot *snap = new rb_sV8HeapSnapshot();
+  snap->snapshot = HeapProfiler::TakeSnapshot(String::New(RSTRING_PTR(title), RSTRING_LEN(title)));
+  snap->isolate = rb_v8_isolate_current();
+  snap->isolate->retain();
+  return Data_Wrap_Struct(klass, 0, rb_v8_heap_snapshot_free, snap);
+}
+
+/*
+ * call-seq:
+ *   snapshot.title  => str
+ *
+ * Returns title of the snapshot.
+ *
+ */
+static VALUE rb_v8_heap_snapshot_title(VALUE self)
+{
+  HandleScope scope;
+  return v8_string_to_utf8(unwrap(self)->GetTitle());
+}
+
+/*
+ * call-seq:
+ *   snapshot.uid  => int
+ *
+ * Returns unique id of the snapshot.
+ *
+ */
+static VALUE rb_v8_heap_snapshot_uid(VALUE self)
+{
+  return UINT2NUM(unwrap(self)->GetUid());
+}
+
+/*
+ * call-seq:
+ *   snapshot.summary  => hash
+ *
+ * Returns number of objects, their own sizes and sizes of everything they
+ * retain (in bytes), grouped by constructor name. Other heap entries are
+ * grouped by type, eg. <code>"(string)"</code> or <code>"(closure)"</code>.
+ *
+ *   snapshot.summary["Foo"] # => {:count => 1000, :self_size => 24000, :retained_size => 88000}
+ *
+ */
+static VALUE rb_v8_heap_snapshot_summary(VALUE self)
+{
+  HandleScope scope;
+  v8_heap_stats_map stats;
+  v8_heap_each_node(unwrap(self), v8_heap_summarize_node, &stats);
+
+  VALUE hash = rb_hash_new();
+
+  for (v8_heap_stats_map::iterator it = stats.begin(); it != stats.end(); ++it) {
+    rb_hash_aset(hash, v8_heap_group_name(it->first), v8_heap_stats_entry(it->second));
+  }
+
+  return hash;
+}
+
+/*
+ * call-seq:
+ *   snapshot.diff(older)  => hash
+ *
+ * Compares snapshot with older one, and returns number and size of objects
+ * allocated and freed in the meantime, grouped as in <code>#summary</code>.
+ *
+ *   snapshot.diff(older)["Foo"] # => {:added => {:count => 10, :self_size => 240, :retained_size => 0},
+ *                               #     :deleted => {:count => 2, :self_size => 48, :retained_size => 0}}
+ *
+ */
+static VALUE rb_v8_heap_snapshot_diff(VALUE self, VALUE other)
+{
+  HandleScope scope;
+
+  if (!rb_obj_is_kind_of(other, rb_cV8HeapSnapshot)) {
+    rb_raise(rb_eTypeError, "wrong argument type (expected heap snapshot)");
+    return Qnil;
+  }
+
+  const HeapSnapshot *snapshot = unwrap(self);
+  const HeapSnapshot *older = unwrap(other);
+
+  v8_heap_diff added, deleted;
+  added.other = older;
+  deleted.other = snapshot;
+  v8_heap_each_node(snapshot, v8_heap_diff_node, &added);
+  v8_heap_each_node(older, v8_heap_diff_node, &deleted);
+
+  std::set<std::string> groups;
+  v8_heap_stats_map::iterator it;
+
+  for (it = added.stats.begin(); it != added.stats.end(); ++it) {
+    groups.insert(it->first);
+  }
+  for (it = deleted.stats.begin(); it != deleted.stats.end(); ++it) {
+    groups.insert(it->first);
+  }
+
+  VALUE hash = rb_hash_new();
+
+  for (std::set<std::string>::iterator group = groups.begin(); group != groups.end(); ++group) {
+    VALUE entry = rb_hash_new();
+    rb_hash_aset(entry, ID2SYM(rb_intern("added")), v8_heap_stats_entry(added.stats[*group]));
+    rb_hash_aset(entry, ID2SYM(rb_intern("deleted")), v8_heap_stats_entry(deleted.stats[*group]));
+    rb_hash_aset(hash, v8_heap_group_name(*group), entry);
+  }
+
+  return hash;
+}
+
+/*
+ * call-seq:
+ *   snapshot.wrapper_retained  => array
+ *
+ * Returns objects which are kept alive only by ruby wrappers (eg. values
+ * returned from javascript and still referenced from ruby), and not by
+ * anything within javascript heap. Growing number of them means that ruby
+ * holds references it doesn't need anymore.
+ *
+ *   snapshot.wrapper_retained # => [{:name => "Foo", :id => 12345, :self_size => 24, :retained_size => 1024}, ...]
+ *
+ */
+static VALUE rb_v8_heap_snapshot_wrapper_retained(VALUE self)
+{
+  HandleScope scope;
+  const HeapSnapshot *snapshot = unwrap(self);
+  const HeapGraphNode *root = snapshot->GetRoot();
+  const HeapGraphNode *gc_roots = v8_heap_find_child(root, "(GC roots)");
+  const HeapGraphNode *natives = v8_heap_find_child(root, "(Native objects)");
+  const HeapGraphNode *wrappers = natives ? v8_heap_find_child(natives, V8_WRAPPERS_LABEL) : NULL;
+  VALUE result = rb_ary_new();
+
+  if (wrappers == NULL) {
+    return result;
+  }
+
+  for (int i = 0; i < wrappers->GetChildrenCount(); i++) {
+    const HeapGraphEdge *edge = wrappers->GetChild(i);
+    const HeapGraphNode *node = edge->GetToNode();
+    bool retained = false;
+
+    if (edge->GetType() != HeapGraphEdge::kElement) {
+      continue;
+    }
+
+    // Each wrapped object is retained by the wrappers group and by its
+    // persistent handle, which is one of the GC roots...
+    for (int j = 0; j < node->GetRetainersCount() && !retained; j++) {
+      const HeapGraphNode *from = node->GetRetainer(j)->GetFromNode();
+      retained = from != wrappers && from != gc_roots;
+    }
+
+    if (!retained) {
+      VALUE entry = rb_hash_new();
+      rb_hash_aset(entry, ID2SYM(rb_intern("name")), v8_heap_group_name(v8_heap_node_group(node)));
+      rb_hash_aset(entry, ID2SYM(rb_intern("id")), ULL2NUM(node->GetId()));
+      rb_hash_aset(entry, ID2SYM(rb_intern("self_size")), INT2NUM(node->GetSelfSize()));
+      rb_hash_aset(entry, ID2SYM(rb_intern("retained_size")), INT2NUM(node->GetRetainedSize(false)));
+      rb_ary_push(result, entry);
+    }
+  }
+
+  return result;
+}
+
+/*
+ * call-seq:
+ *   snapshot.delete  => nil
+ *
+ * Deletes the snapshot and frees memory used by it. Otherwise it's deleted
+ * when collected by ruby's GC.
+ *
+ */
+static VALUE rb_v8_heap_snapshot_delete(VALUE self)
+{
+  unwrap(self);
+  rb_sV8HeapSnapshot *snap = 0;
+  Data_Get_Struct(self, struct rb_sV8HeapSnapshot, snap);
+  const_cast<HeapSnapshot*>(snap->snapshot)->Delete();
+  snap->snapshot = NULL;
+  return Qnil;
+}
+
+
+/* V8::HeapSnapshot initializer. */
+void Init_V8_HeapSnapshot()
+{
+  rb_cV8HeapSnapshot = rb_define_class_under(rb_mV8, "HeapSnapshot", rb_cObject);
+  rb_undef_alloc_func(rb_cV8HeapSnapshot);
+  rb_define_singleton_method(rb_cV8HeapSnapshot, "take", RUBY_METHOD_FUNC(rb_v8_heap_snapshot_take), -1);
+  rb_define_method(rb_cV8HeapSnapshot, "title", RUBY_METHOD_FUNC(rb_v8_heap_snapshot_title), 0);
+  rb_define_method(rb_cV8HeapSnapshot, "uid", RUBY_METHOD_FUNC(rb_v8_heap_snapshot_uid), 0);
+  rb_define_method(rb_cV8HeapSnapshot, "summary", RUBY_METHOD_FUNC(rb_v8_heap_snapshot_summary), 0);
+  rb_define_method(rb_cV8HeapSnapshot, "diff", RUBY_METHOD_FUNC(rb_v8_heap_snapshot_diff), 1);
+  rb_define_method(rb_cV8HeapSnapshot, "wrapper_retained", RUBY_METHOD_FUNC(rb_v8_heap_snapshot_wrapper_retained), 0);
+  rb_define_method(rb_cV8HeapSnapshot, "delete", RUBY_METHOD_FUNC(rb_v8_heap_snapshot_delete), 0);
+}
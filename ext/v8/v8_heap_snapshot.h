@@ -0,0 +1,14 @@
+#ifndef __V8_HEAP_SNAPSHOT_H
+#define __V8_HEAP_SNAPSHOT_H
+
+#include "v8_main.h"
+
+using namespace v8;
+
+/* V8::HeapSnapshot class */
+RUBY_EXTERN VALUE rb_cV8HeapSnapshot;
+
+/* API */
+void Init_V8_HeapSnapshot();
+
+#endif//__V8_HEAP_SNAPSHOT_H
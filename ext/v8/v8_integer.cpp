@@ -13,7 +13,14 @@ UNWRAPPER(Integer);
 
 Handle<Value> to_v8_integer(VALUE value)
 {
-  return Integer::New(FIX2LONG(value));
+  long num = FIX2LONG(value);
+
+  // Fixnums on 64 bit platforms don't have to fit in 32 bit V8 integer.
+  if (num >= INT32_MIN && num <= INT32_MAX) {
+    return Integer::New((int32_t)num);
+  } else {
+    return Number::New((double)num);
+  }
 }
 
 /* V8::Integer methods */
@@ -0,0 +1,355 @@
+#include "v8_ref.h"
+#include "v8_cast.h"
+#include "v8_value.h"
+#include "v8_context.h"
+#include "v8_script.h"
+#include "v8_isolate.h"
+#include "v8_locker.h"
+#include "v8_macros.h"
+
+using namespace v8;
+
+VALUE rb_cV8Isolate;
+
+/* Isolates created from ruby, keyed by V8 isolate pointers. */
+static st_table *isolates = 0;
+
+/* Entered isolates, kept here to protect them from GC. */
+static VALUE entered_isolates = Qnil;
+
+/* State of the default isolate, used when no other isolate is entered. */
+static rb_sV8Isolate default_isolate(NULL, Qnil);
+
+void rb_v8_isolate_gc_mark(rb_sV8Isolate *iso)
+{
+  rb_gc_mark(iso->thread);
+  rb_gc_mark(iso->reflections);
+}
+
+void rb_v8_isolate_gc_free(rb_sV8Isolate *iso)
+{
+  st_data_t key = (st_data_t)iso->isolate;
+  st_delete(isolates, &key, 0);
+
+  if (iso->refs > 0) {
+    // Reflected objects keeps their isolate alive, so it can happen only
+    // on exit, when all objects are freed in random order...
+    iso->orphaned = true;
+  } else {
+    if (!iso->disposed && iso->entered == 0) {
+      v8_release_retained(iso->isolate);
+      iso->isolate->Dispose();
+    }
+    delete iso;
+  }
+}
+
+static rb_sV8Isolate *unwrap(VALUE self)
+{
+  rb_sV8Isolate *iso = 0;
+  Data_Get_Struct(self, struct rb_sV8Isolate, iso);
+  return iso;
+}
+
+/*
+ * Returns isolate entered in current thread. If it's not one of isolates
+ * created from ruby then default isolate is returned.
+ *
+ */
+rb_sV8Isolate *rb_v8_isolate_current()
+{
+  Isolate *isolate = Isolate::GetCurrent();
+  st_data_t iso;
+
+  if (isolate != NULL && st_lookup(isolates, (st_data_t)isolate, &iso)) {
+    return (rb_sV8Isolate*)iso;
+  }
+  if (default_isolate.isolate == NULL) {
+    default_isolate.isolate = isolate;
+  }
+
+  return &default_isolate;
+}
+
+/*
+ * Returns name of hidden value which contains ruby peer. It's looked up on
+ * each conversion, so symbol is created only once per isolate and kept as
+ * persistent handle.
+ *
+ */
+Handle<String> v8_peer_key()
+{
+  rb_sV8Isolate *iso = rb_v8_isolate_current();
+
+  if (iso->peer_key.IsEmpty()) {
+    iso->peer_key = Persistent<String>::New(String::NewSymbol(RUBY_PEER_ATTR));
+  }
+
+  return iso->peer_key;
+}
+
+/* The v8_isolate struct methods. */
+
+rb_sV8Isolate::rb_sV8Isolate(Isolate *isolate, VALUE self)
+  : isolate(isolate), self(self), thread(Qnil), entered(0), refs(0),
+    disposed(false), orphaned(false), templates(NULL), reflections(Qnil), proxy_methods(NULL)
+{
+}
+
+rb_sV8Isolate::~rb_sV8Isolate()
+{
+  // Default isolate is static and it's destroyed after ruby VM is gone, so
+  // its tables are left for the system to clean up...
+  if (!NIL_P(self)) {
+    if (templates != NULL) {
+      st_free_table(templates);
+    }
+    if (proxy_methods != NULL) {
+      st_free_table(proxy_methods);
+    }
+  }
+}
+
+void rb_sV8Isolate::retain()
+{
+  refs++;
+}
+
+void rb_sV8Isolate::release(Persistent<void> handle)
+{
+  if (!disposed && !orphaned) {
+    if (current()) {
+      handle.Dispose();
+    } else {
+      garbage.push_back(handle);
+    }
+  }
+  if (--refs == 0 && orphaned) {
+    delete this;
+  }
+}
+
+void rb_sV8Isolate::dispose_garbage()
+{
+  if (!garbage.empty() && current()) {
+    for (size_t i = 0; i < garbage.size(); i++) {
+      garbage[i].Dispose();
+    }
+    garbage.clear();
+  }
+}
+
+/*
+ * Returns <code>true</code> when isolate can be safely used from within
+ * current thread, which means it's entered here and not executing any
+ * javascript code in the background.
+ *
+ */
+bool rb_sV8Isolate::current()
+{
+  if (isolate == NULL || isolate != Isolate::GetCurrent() || rb_v8_gvl_released()) {
+    return false;
+  } else if (NIL_P(self) && Locker::IsActive()) {
+    return Locker::IsLocked();
+  }
+
+  return true;
+}
+
+/* V8::Isolate methods */
+
+/*
+ * call-seq:
+ *   V8::Isolate.new  => new_isolate
+ *
+ * Returns new, isolated instance of V8 engine, with its own heap and
+ * garbage collector. Contexts and objects created after entering isolate
+ * belongs to it, and can't be used within any other isolate.
+ *
+ */
+static VALUE rb_v8_isolate_new(VALUE klass)
+{
+  rb_sV8Isolate *iso = new rb_sV8Isolate(Isolate::New(), Qnil);
+  VALUE self = Data_Wrap_Struct(klass, rb_v8_isolate_gc_mark, rb_v8_isolate_gc_free, iso);
+  iso->self = self;
+  st_insert(isolates, (st_data_t)iso->isolate, (st_data_t)iso);
+  return self;
+}
+
+/*
+ * call-seq:
+ *   V8::Isolate.current  => isolate or nil
+ *
+ * Returns isolate entered in current thread, or <code>nil</code> when
+ * default one is used.
+ *
+ */
+static VALUE rb_v8_isolate_current_m(VALUE klass)
+{
+  return rb_v8_isolate_current()->self;
+}
+
+/*
+ * call-seq:
+ *   iso.exit  => nil
+ *
+ * Exits from isolate, and restores previously entered one.
+ *
+ */
+static VALUE rb_v8_isolate_exit(VALUE self)
+{
+  rb_sV8Isolate *iso = unwrap(self);
+
+  if (iso->entered == 0) {
+    return Qnil;
+  } else if (iso->thread != rb_thread_current() || Isolate::GetCurrent() != iso->isolate) {
+    rb_raise(rb_eRuntimeError, "can't exit isolate which is not the current one");
+    return Qnil;
+  }
+
+  iso->dispose_garbage();
+  iso->isolate->Exit();
+
+  if (--iso->entered == 0) {
+    iso->thread = Qnil;
+    rb_ary_delete(entered_isolates, self);
+  }
+
+  return Qnil;
+}
+
+/*
+ * call-seq:
+ *   iso.enter                => true
+ *   iso.enter { |iso| ... }  => result
+ *
+ * Enters isolate, so all subsequent V8 operations in current thread are
+ * performed within it. Isolate can be entered only by one thread at time.
+ *
+ * If block passed then isolate is entered only for block execution, and
+ * exited imidietely after that.
+ *
+ *   iso = V8::Isolate.new
+ *   Thread.new { iso.enter { V8::Context.new.eval("1+1", "<eval>") } }
+ *
+ */
+static VALUE rb_v8_isolate_enter(VALUE self)
+{
+  rb_sV8Isolate *iso = unwrap(self);
+  VALUE thread = rb_thread_current();
+
+  if (iso->disposed) {
+    rb_raise(rb_eRuntimeError, "can't enter disposed isolate");
+    return Qnil;
+  } else if (iso->entered > 0 && iso->thread != thread) {
+    rb_raise(rb_eRuntimeError, "isolate is already entered by another thread");
+    return Qnil;
+  }
+
+  iso->isolate->Enter();
+
+  if (iso->entered++ == 0) {
+    iso->thread = thread;
+    rb_ary_push(entered_isolates, self);
+  }
+
+  iso->dispose_garbage();
+
+  if (rb_block_given_p()) {
+    return rb_ensure(RUBY_METHOD_FUNC(rb_yield), self, RUBY_METHOD_FUNC(rb_v8_isolate_exit), self);
+  }
+
+  return Qtrue;
+}
+
+/*
+ * call-seq:
+ *   iso.entered?  => true or false
+ *
+ * Returns <code>true</code> when isolate is entered in current thread.
+ *
+ */
+static VALUE rb_v8_isolate_entered_p(VALUE self)
+{
+  rb_sV8Isolate *iso = unwrap(self);
+  return iso->entered > 0 && Isolate::GetCurrent() == iso->isolate ? Qtrue : Qfalse;
+}
+
+/*
+ * call-seq:
+ *   iso.dispose  => nil
+ *
+ * Disposes isolate and frees all its resources. Objects which belongs to
+ * disposed isolate can't be used anymore.
+ *
+ */
+static VALUE rb_v8_isolate_dispose(VALUE self)
+{
+  rb_sV8Isolate *iso = unwrap(self);
+
+  if (iso->entered > 0) {
+    rb_raise(rb_eRuntimeError, "can't dispose entered isolate");
+    return Qnil;
+  }
+  if (!iso->disposed) {
+    v8_release_retained(iso->isolate);
+    iso->garbage.clear();
+    iso->isolate->Dispose();
+    iso->disposed = true;
+  }
+
+  return Qnil;
+}
+
+/*
+ * call-seq:
+ *   iso.disposed?  => true or false
+ *
+ * Returns <code>true</code> when isolate has been disposed.
+ *
+ */
+static VALUE rb_v8_isolate_disposed_p(VALUE self)
+{
+  return unwrap(self)->disposed ? Qtrue : Qfalse;
+}
+
+/*
+ * call-seq:
+ *   obj.isolate  => isolate or nil
+ *
+ * Returns isolate which owns reflected object, or <code>nil</code> when
+ * it belongs to the default one.
+ *
+ */
+static VALUE rb_v8_data_isolate(VALUE self)
+{
+  rb_sV8Wrapper *r = 0;
+  Data_Get_Struct(self, struct rb_sV8Wrapper, r);
+  return r->isolate->self;
+}
+
+
+/* V8::Isolate initializer. */
+void Init_V8_Isolate()
+{
+  isolates = st_init_numtable();
+  entered_isolates = rb_ary_new();
+  rb_gc_register_address(&entered_isolates);
+
+  // Default isolate is never wrapped by ruby object, so reflections owned
+  // by it have to be protected from GC separately...
+  rb_gc_register_address(&default_isolate.reflections);
+
+  rb_cV8Isolate = rb_define_class_under(rb_mV8, "Isolate", rb_cObject);
+  rb_define_singleton_method(rb_cV8Isolate, "new", RUBY_METHOD_FUNC(rb_v8_isolate_new), 0);
+  rb_define_singleton_method(rb_cV8Isolate, "current", RUBY_METHOD_FUNC(rb_v8_isolate_current_m), 0);
+  rb_define_method(rb_cV8Isolate, "enter", RUBY_METHOD_FUNC(rb_v8_isolate_enter), 0);
+  rb_define_method(rb_cV8Isolate, "exit", RUBY_METHOD_FUNC(rb_v8_isolate_exit), 0);
+  rb_define_method(rb_cV8Isolate, "entered?", RUBY_METHOD_FUNC(rb_v8_isolate_entered_p), 0);
+  rb_define_method(rb_cV8Isolate, "dispose", RUBY_METHOD_FUNC(rb_v8_isolate_dispose), 0);
+  rb_define_method(rb_cV8Isolate, "disposed?", RUBY_METHOD_FUNC(rb_v8_isolate_disposed_p), 0);
+
+  rb_define_method(rb_cV8Value, "isolate", RUBY_METHOD_FUNC(rb_v8_data_isolate), 0);
+  rb_define_method(rb_cV8Context, "isolate", RUBY_METHOD_FUNC(rb_v8_data_isolate), 0);
+  rb_define_method(rb_cV8Script, "isolate", RUBY_METHOD_FUNC(rb_v8_data_isolate), 0);
+}
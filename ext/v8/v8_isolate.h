@@ -0,0 +1,46 @@
+#ifndef __V8_ISOLATE_H
+#define __V8_ISOLATE_H
+
+#include "v8_main.h"
+#include <vector>
+
+using namespace v8;
+
+/* V8::Isolate class */
+RUBY_EXTERN VALUE rb_cV8Isolate;
+
+/*
+ * Keeps state of single V8 engine instance. Each reflected object is tagged
+ * with isolate which owns it. Persistent handles released by ruby's GC when
+ * their isolate can't be touched (eg. it's used by other thread), are kept
+ * as garbage and disposed next time the isolate is entered.
+ *
+ */
+struct rb_sV8Isolate {
+  rb_sV8Isolate(Isolate *isolate, VALUE self);
+  ~rb_sV8Isolate();
+  void retain();
+  void release(Persistent<void> handle);
+  void dispose_garbage();
+  bool current();
+  Isolate *isolate;
+  VALUE self;
+  VALUE thread;
+  int entered;
+  int refs;
+  bool disposed;
+  bool orphaned;
+  std::vector< Persistent<void> > garbage;
+  Persistent<String> peer_key;
+  st_table *templates;
+  VALUE reflections;
+  Persistent<FunctionTemplate> proxy_template;
+  st_table *proxy_methods;
+};
+
+/* API */
+rb_sV8Isolate *rb_v8_isolate_current();
+Handle<String> v8_peer_key();
+void Init_V8_Isolate();
+
+#endif//__V8_ISOLATE_H
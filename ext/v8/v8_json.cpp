@@ -0,0 +1,234 @@
+#include "v8_ref.h"
+#include "v8_cast.h"
+#include "v8_value.h"
+#include "v8_context.h"
+#include "v8_string.h"
+#include "v8_errors.h"
+#include "v8_script.h"
+#include "v8_json.h"
+#include "v8_macros.h"
+
+using namespace v8;
+
+/* Names of hidden values which keep builtin JSON functions of context. */
+#define JSON_PARSE_ATTR "__MUSTANG_JSON_PARSE__"
+#define JSON_STRINGIFY_ATTR "__MUSTANG_JSON_STRINGIFY__"
+
+/* Local helpers */
+
+static VALUE v8_json_write_chunk(VALUE chunk, VALUE io)
+{
+  return rb_funcall2(io, rb_intern("write"), 1, &chunk);
+}
+
+struct v8_json_call_args {
+  Handle<Function> func;
+  Handle<Object> recv;
+  Handle<Value> arg;
+  Local<Value> result;
+};
+
+static void *v8_json_call_nogvl(void *data)
+{
+  v8_json_call_args *call = (v8_json_call_args*)data;
+  call->result = call->func->Call(call->recv, 1, &call->arg);
+  return NULL;
+}
+
+/*
+ * Calls builtin JSON function with given argument. Parser's reviver and
+ * serialized objects can call back to ruby, so it's executed the same way
+ * as any other script.
+ *
+ */
+static Local<Value> v8_json_call(Handle<Function> func, Handle<Object> recv, Handle<Value> arg)
+{
+  v8_json_call_args call;
+  call.func = func;
+  call.recv = recv;
+  call.arg = arg;
+  v8_execute(v8_json_call_nogvl, &call);
+  return call.result;
+}
+
+/*
+ * Returns builtin JSON function captured for specified context, or empty
+ * handle when there is no such function.
+ *
+ */
+static Handle<Function> v8_json_function(Handle<Context> context, const char *attr)
+{
+  HandleScope scope;
+  Handle<Value> func = context->Global()->GetHiddenValue(String::NewSymbol(attr));
+
+  if (!func.IsEmpty() && func->IsFunction()) {
+    return scope.Close(Handle<Function>::Cast(func));
+  }
+
+  return Handle<Function>();
+}
+
+static void v8_json_capture_function(Handle<Object> global, Handle<Object> json, const char *name, const char *attr)
+{
+  Handle<Value> func = json->Get(String::NewSymbol(name));
+
+  if (!func.IsEmpty() && func->IsFunction()) {
+    global->SetHiddenValue(String::NewSymbol(attr), func);
+  }
+}
+
+/*
+ * Captures builtin JSON parser and serializer of given context. It has to be
+ * done right after context is created, before any script can replace global
+ * JSON object. Functions are kept as hidden values of context's global, so
+ * they live as long as the context and aren't reachable from scripts.
+ *
+ */
+void v8_json_capture(Handle<Context> context)
+{
+  HandleScope scope;
+  Context::Scope context_scope(context);
+  Handle<Object> global = context->Global();
+  Handle<Value> json = global->Get(String::NewSymbol("JSON"));
+
+  if (!json.IsEmpty() && json->IsObject()) {
+    v8_json_capture_function(global, Handle<Object>::Cast(json), "parse", JSON_PARSE_ATTR);
+    v8_json_capture_function(global, Handle<Object>::Cast(json), "stringify", JSON_STRINGIFY_ATTR);
+  }
+}
+
+/* V8::Context methods */
+
+/*
+ * call-seq:
+ *   cxt.parse_json(str)  => value
+ *
+ * Parses given JSON string with native parser of the context, and returns
+ * resulting value. When string is not a valid JSON then returns
+ * <code>V8::SyntaxError</code>. Builtin parser is always used, even if
+ * global JSON object has been replaced by some script.
+ *
+ *   cxt = V8::Context.new
+ *   cxt.parse_json('{"foo": [1, 2]}')  # => {"foo" => [1, 2]}
+ *   cxt.parse_json('{foo')             # => #<V8::SyntaxError>
+ *
+ */
+static VALUE rb_v8_context_parse_json(VALUE self, VALUE str)
+{
+  StringValue(str);
+  VALUE result = Qundef;
+
+  {
+    HandleScope scope;
+    Handle<Context> context = v8_handle_from_wrapper<Context>(self);
+    Context::Scope context_scope(context);
+    Handle<Function> parse = v8_json_function(context, JSON_PARSE_ATTR);
+
+    if (!parse.IsEmpty()) {
+      Handle<Value> source = String::New(RSTRING_PTR(str), RSTRING_LEN(str));
+      TryCatch try_catch;
+      Local<Value> parsed = v8_json_call(parse, context->Global(), source);
+      result = try_catch.HasCaught() ? rb_v8_error_new3(try_catch) : to_ruby(parsed);
+    }
+  }
+
+  v8_rethrow_ruby_jump();
+
+  if (result == Qundef) {
+    rb_raise(rb_eRuntimeError, "JSON is not available within this context");
+  }
+
+  return result;
+}
+
+/* V8::Value methods */
+
+/*
+ * call-seq:
+ *   value.to_json         => str
+ *   value.to_json(state)  => str
+ *   value.to_json(io)     => io
+ *
+ * Serializes value with native JSON serializer. Values which can't be
+ * represented in JSON (eg. functions) are serialized as <code>null</code>,
+ * so the result can be embedded by JSON libraries, which call this method
+ * with their generator state. When IO is given, then output is written to
+ * it in chunks instead of being returned as one string. When serializer
+ * fails (eg. on circular structure) then <code>RuntimeError</code> with
+ * description of javascript error is raised.
+ *
+ *   obj = cxt.eval("({foo: [1, 2]})", "<eval>")
+ *   obj.to_json                          # => '{"foo":[1,2]}'
+ *   File.open("foo.json", "w") { |f| obj.to_json(f) }
+ *
+ */
+static VALUE rb_v8_value_to_json(int argc, VALUE *argv, VALUE self)
+{
+  // JSON libraries call #to_json with their own generator state, so only
+  // objects which can be written to are taken as output...
+  VALUE io = argc > 0 && rb_respond_to(argv[0], rb_intern("write")) ? argv[0] : Qnil;
+  VALUE result = Qnil;
+  VALUE failure = Qnil;
+  const char *error = NULL;
+  int state = 0;
+
+  {
+    HandleScope scope;
+    Handle<Value> value = v8_handle_from_wrapper<Value>(self);
+    Handle<Context> context;
+
+    if (Context::InContext()) {
+      context = Context::GetCurrent();
+    } else if (value->IsObject()) {
+      context = Handle<Object>::Cast(value)->CreationContext();
+    }
+
+    if (context.IsEmpty()) {
+      error = "can't serialize V8 value without entering into context";
+    } else {
+      Context::Scope context_scope(context);
+      Handle<Function> stringify = v8_json_function(context, JSON_STRINGIFY_ATTR);
+
+      if (stringify.IsEmpty()) {
+        error = "JSON is not available within this context";
+      } else {
+        TryCatch try_catch;
+        Local<Value> json = v8_json_call(stringify, context->Global(), value);
+
+        if (try_catch.HasCaught()) {
+          // Error details can be reflected only here, within the context...
+          failure = rb_funcall2(rb_v8_error_new3(try_catch), rb_intern("inspect"), 0, NULL);
+        } else {
+          Handle<String> str = json->IsString() ? Handle<String>::Cast(json) : String::New("null");
+
+          if (NIL_P(io)) {
+            result = v8_string_to_utf8(str);
+          } else {
+            // Writes are protected, so IO errors don't jump over V8 scopes...
+            state = v8_string_each_chunk(str, V8_STRING_CHUNK_SIZE, v8_json_write_chunk, io);
+            result = io;
+          }
+        }
+      }
+    }
+  }
+
+  v8_rethrow_ruby_jump();
+
+  if (state != 0) {
+    rb_jump_tag(state);
+  } else if (error != NULL) {
+    rb_raise(rb_eRuntimeError, "%s", error);
+  } else if (!NIL_P(failure)) {
+    rb_exc_raise(rb_exc_new3(rb_eRuntimeError, failure));
+  }
+
+  return result;
+}
+
+/* JSON bridge initializer. */
+void Init_V8_JSON()
+{
+  rb_define_method(rb_cV8Context, "parse_json", RUBY_METHOD_FUNC(rb_v8_context_parse_json), 1);
+  rb_define_method(rb_cV8Value, "to_json", RUBY_METHOD_FUNC(rb_v8_value_to_json), -1);
+}
@@ -0,0 +1,12 @@
+#ifndef __V8_JSON_H
+#define __V8_JSON_H
+
+#include "v8_main.h"
+
+using namespace v8;
+
+/* API */
+void v8_json_capture(Handle<Context> context);
+void Init_V8_JSON();
+
+#endif//__V8_JSON_H
@@ -0,0 +1,228 @@
+#include "v8_main.h"
+#include "v8_locker.h"
+#include "v8_isolate.h"
+#include "v8_macros.h"
+
+#ifdef HAVE_RUBY_THREAD_H
+#include <ruby/thread.h>
+#endif
+
+#if defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL) && defined(HAVE_RB_THREAD_CALL_WITH_GVL)
+#define V8_CAN_RELEASE_GVL 1
+#endif
+
+using namespace v8;
+
+/* Isolate which executes javascript without GVL in current thread. */
+static __thread rb_sV8Isolate *released_isolate = NULL;
+
+/*
+ * Whether current thread executes javascript without GVL. It's kept per
+ * thread, because the default isolate is shared by all threads using the
+ * V8 lock, and one thread's state can't leak into others.
+ *
+ */
+static __thread bool gvl_released = false;
+
+/* Local helpers */
+
+static void *v8_locker_new(void *data)
+{
+  return (void*)new Locker();
+}
+
+static void *v8_unlocker_delete(void *unlocker)
+{
+  delete (Unlocker*)unlocker;
+  return NULL;
+}
+
+static VALUE v8_locker_delete(VALUE locker)
+{
+  delete (Locker*)locker;
+  return Qnil;
+}
+
+static VALUE v8_unlocker_ensure(VALUE unlocker)
+{
+  // Getting lock back can block, so it has to be done without GVL...
+#ifdef V8_CAN_RELEASE_GVL
+  rb_thread_call_without_gvl(v8_unlocker_delete, (void*)unlocker, NULL, NULL);
+#else
+  v8_unlocker_delete((void*)unlocker);
+#endif
+  return Qnil;
+}
+
+/*
+ * Executes given function without ruby's GVL when current thread holds
+ * the V8 lock or works within own isolate, so other ruby threads can run
+ * while javascript is executed. Otherwise function is executed normally.
+ *
+ */
+void *rb_v8_without_gvl(void *(*func)(void *), void *data)
+{
+#ifdef V8_CAN_RELEASE_GVL
+  rb_sV8Isolate *iso = rb_v8_isolate_current();
+
+  // Isolates created from ruby can be entered only by one thread at time,
+  // while the default one has to be guarded with the V8 lock...
+  if (!gvl_released && (!NIL_P(iso->self) || (Locker::IsActive() && Locker::IsLocked()))) {
+    rb_sV8Isolate *prev = released_isolate;
+    released_isolate = iso;
+    gvl_released = true;
+    void *result = rb_thread_call_without_gvl(func, data, NULL, NULL);
+    gvl_released = false;
+    released_isolate = prev;
+    return result;
+  }
+#endif
+  return func(data);
+}
+
+/*
+ * Executes given function with ruby's GVL. When GVL has been released by
+ * <code>rb_v8_without_gvl</code> then it's reacquired for execution time.
+ *
+ */
+void *rb_v8_with_gvl(void *(*func)(void *), void *data)
+{
+#ifdef V8_CAN_RELEASE_GVL
+  // We can't look for current isolate without GVL...
+  if (released_isolate != NULL && gvl_released) {
+    gvl_released = false;
+    void *result = rb_thread_call_with_gvl(func, data);
+    gvl_released = true;
+    return result;
+  }
+#endif
+  return func(data);
+}
+
+/*
+ * Returns <code>true</code> when current thread executes javascript without
+ * GVL, so V8 handles can't be touched from here.
+ *
+ */
+bool rb_v8_gvl_released()
+{
+  return gvl_released;
+}
+
+/* V8 locking singleton methods. */
+
+/*
+ * call-seq:
+ *   V8.lock { ... }  => result
+ *
+ * Executes given block holding the V8 lock. Within locked block javascript
+ * code is executed without ruby's GVL, so other ruby threads are not stalled
+ * while it runs. GVL is reacquired when javascript calls back ruby code.
+ *
+ * Once lock has been used, all threads have to use V8 from within locked
+ * blocks only. Lock guards the default isolate, so it can't be mixed with
+ * isolates created from ruby.
+ *
+ *   Thread.new { V8.lock { cxt.eval("heavy()", "<eval>") } }
+ *
+ */
+static VALUE rb_v8_lock(VALUE self)
+{
+  if (!rb_block_given_p()) {
+    rb_raise(rb_eArgError, "no block given");
+    return Qnil;
+  }
+
+  // Waiting for the V8 lock while holding GVL could deadlock with thread
+  // which holds V8 lock and waits for GVL, so we have to release it here...
+#ifdef V8_CAN_RELEASE_GVL
+  Locker *locker = (Locker*)rb_thread_call_without_gvl(v8_locker_new, NULL, NULL, NULL);
+#else
+  Locker *locker = (Locker*)v8_locker_new(NULL);
+#endif
+  
+  return rb_ensure(RUBY_METHOD_FUNC(rb_yield), Qnil, RUBY_METHOD_FUNC(v8_locker_delete), (VALUE)locker);
+}
+
+/*
+ * call-seq:
+ *   V8.unlock { ... }  => result
+ *
+ * Executes given block without the V8 lock, so other threads can use V8
+ * in the meantime. Lock is taken back after block execution.
+ *
+ */
+static VALUE rb_v8_unlock(VALUE self)
+{
+  if (!rb_block_given_p()) {
+    rb_raise(rb_eArgError, "no block given");
+    return Qnil;
+  }
+
+  if (!Locker::IsActive() || !Locker::IsLocked()) {
+    return rb_yield(Qnil);
+  }
+
+  Unlocker *unlocker = new Unlocker();
+  return rb_ensure(RUBY_METHOD_FUNC(rb_yield), Qnil, RUBY_METHOD_FUNC(v8_unlocker_ensure), (VALUE)unlocker);
+}
+
+/*
+ * call-seq:
+ *   V8.locked?  => true or false
+ *
+ * Returns <code>true</code> when current thread holds the V8 lock.
+ *
+ */
+static VALUE rb_v8_locked_p(VALUE self)
+{
+  return Locker::IsActive() && Locker::IsLocked() ? Qtrue : Qfalse;
+}
+
+/*
+ * call-seq:
+ *   V8.start_preemption(ms)  => nil
+ *
+ * Starts preemption, so threads waiting for the V8 lock gets it in turns,
+ * every given number of milliseconds, even when current holder executes
+ * long running javascript. Preemption can be started only from within
+ * locked block.
+ *
+ *   V8.lock { V8.start_preemption(50) }
+ *   threads = jobs.map { |job| Thread.new { V8.lock { cxt.eval(job, "<eval>") } } }
+ *
+ */
+static VALUE rb_v8_start_preemption(VALUE self, VALUE ms)
+{
+  if (!Locker::IsActive() || !Locker::IsLocked()) {
+    rb_raise(rb_eRuntimeError, "can't start preemption without holding the V8 lock");
+    return Qnil;
+  }
+
+  Locker::StartPreemption(NUM2INT(ms));
+  return Qnil;
+}
+
+/*
+ * call-seq:
+ *   V8.stop_preemption  => nil
+ *
+ * Stops preemption started with <code>V8.start_preemption</code>.
+ *
+ */
+static VALUE rb_v8_stop_preemption(VALUE self)
+{
+  Locker::StopPreemption();
+  return Qnil;
+}
+
+
+/* V8 locking initializer. */
+void Init_V8_Locker()
+{
+  rb_define_singleton_method(rb_mV8, "lock", RUBY_METHOD_FUNC(rb_v8_lock), 0);
+  rb_define_singleton_method(rb_mV8, "unlock", RUBY_METHOD_FUNC(rb_v8_unlock), 0);
+  rb_define_singleton_method(rb_mV8, "locked?", RUBY_METHOD_FUNC(rb_v8_locked_p), 0);
+  rb_define_singleton_method(rb_mV8, "start_preemption", RUBY_METHOD_FUNC(rb_v8_start_preemption), 1);
+  rb_define_singleton_method(rb_mV8, "stop_preemption", RUBY_METHOD_FUNC(rb_v8_stop_preemption), 0);
+}
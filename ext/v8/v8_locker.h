@@ -0,0 +1,14 @@
+#ifndef __V8_LOCKER_H
+#define __V8_LOCKER_H
+
+#include "v8_main.h"
+
+using namespace v8;
+
+/* API */
+void *rb_v8_without_gvl(void *(*func)(void *), void *data);
+void *rb_v8_with_gvl(void *(*func)(void *), void *data);
+bool rb_v8_gvl_released();
+void Init_V8_Locker();
+
+#endif//__V8_LOCKER_H
@@ -13,6 +13,22 @@
 #define rb_any_to_ary(range) rb_funcall2(value, rb_intern("to_a"), 0, NULL)
 #endif
 
+#ifndef HAVE_RB_CHECK_ID
+#define rb_check_id(namep) rb_intern_str(*(namep))
+#endif
+
+/* Not declared in public headers, but exported by rubies with lazy sweep. */
+#ifdef HAVE_RB_OBJSPACE_GARBAGE_OBJECT_P
+extern "C" int rb_objspace_garbage_object_p(VALUE obj);
+#else
+#define rb_objspace_garbage_object_p(obj) 0
+#endif
+
+/* State of rb_protect when ruby exception has been raised. */
+#ifndef TAG_RAISE
+#define TAG_RAISE 0x6
+#endif
+
 #ifndef RUBY_EXTERN
 #define RUBY_EXTERN extern
 #endif
@@ -44,6 +44,24 @@ static VALUE rb_v8_version(VALUE self)
   return rb_str_new2(V8::GetVersion());
 }
 
+/*
+ * call-seq:
+ *   V8.snapshot?  => true or false
+ *
+ * Returns <code>true</code> when V8 engine has been built with startup
+ * snapshot, so new contexts are deserialized from prebuilt heap instead
+ * of bootstrapping natives from the javascript sources.
+ *
+ */
+static VALUE rb_v8_snapshot_p(VALUE self)
+{
+#ifdef HAVE_V8_SNAPSHOT
+  return Qtrue;
+#else
+  return Qfalse;
+#endif
+}
+
 /*
  * call-seq:
  *   V8.enable_debug!(port)
@@ -68,4 +86,5 @@ void Init_V8()
   rb_define_singleton_method(rb_mV8, "debugger!", RUBY_METHOD_FUNC(rb_v8_debugger_bang), 1);
   rb_define_singleton_method(rb_mV8, "debug!", RUBY_METHOD_FUNC(rb_v8_debugger_bang), 1);
   rb_define_singleton_method(rb_mV8, "version", RUBY_METHOD_FUNC(rb_v8_version), 0);
+  rb_define_singleton_method(rb_mV8, "snapshot?", RUBY_METHOD_FUNC(rb_v8_snapshot_p), 0);
 }
@@ -3,39 +3,203 @@
 #include "v8_object.h"
 #include "v8_value.h"
 #include "v8_string.h"
+#include "v8_locker.h"
+#include "v8_errors.h"
 #include "v8_macros.h"
 
 #include <string.h>
+#include <vector>
 
 using namespace v8;
 
 VALUE rb_cV8Object;
 UNWRAPPER(Object);
 
+/* Reflection helpers */
+
+/* Ruby method exposed in prototype of reflected class. */
+struct v8_method {
+  ID id;
+  int arity;
+};
+
+/*
+ * Reflection of ruby class, owned by isolate together with its cached
+ * function template. It keeps the class (which is the cache key) and
+ * descriptors of its exposed methods, so they're freed with the isolate.
+ *
+ */
+struct v8_class_reflection {
+  VALUE klass;
+  std::vector<v8_method> methods;
+};
+
+static void v8_class_reflection_gc_mark(v8_class_reflection *r)
+{
+  rb_gc_mark(r->klass);
+}
+
+static void v8_class_reflection_gc_free(v8_class_reflection *r)
+{
+  delete r;
+}
+
+struct v8_method_call_args {
+  const Arguments *args;
+  Handle<Value> result;
+};
+
+static VALUE v8_method_call_protected(VALUE data)
+{
+  v8_method_call_args *call = (v8_method_call_args*)data;
+  const Arguments &args = *call->args;
+  v8_method *meth = (v8_method*)External::Unwrap(args.Data());
+  VALUE recv = (VALUE)args.Holder()->GetPointerFromInternalField(0);
+  VALUE meth_args[args.Length()];
+
+  if (meth->arity < 0 || meth->arity == args.Length()) {
+    for (int i = 0; i < args.Length(); i++) {
+      meth_args[i] = to_ruby(args[i]);
+    }
+
+    call->result = to_v8(rb_funcall2(recv, meth->id, args.Length(), meth_args));
+  } else {
+    call->result = ThrowException(Exception::Error(String::New("wrong number of arguments")));
+  }
+
+  return Qnil;
+}
+
+/*
+ * Calls reflected method, rescuing all ruby exceptions and rethrowing them
+ * as javascript errors.
+ *
+ */
+static void *v8_method_call(void *data)
+{
+  int state = 0;
+  rb_protect(v8_method_call_protected, (VALUE)data, &state);
+
+  if (state) {
+    ((v8_method_call_args*)data)->result = v8_throw_ruby_error(state);
+  }
+
+  return NULL;
+}
+
+static Handle<Value> method_caller(const Arguments &args)
+{
+  HandleScope scope;
+  v8_method_call_args call;
+  call.args = &args;
+  call.result = Null();
+
+  // Same as with procs, ruby stuff can't be touched without GVL...
+  rb_v8_with_gvl(v8_method_call, &call);
+  return scope.Close(call.result);
+}
+
+/*
+ * Returns function template reflecting given ruby class. All declared methods
+ * of the class are exposed in template's prototype, and reflected instance
+ * keeps ruby object in its internal field. Templates are built once per class
+ * and isolate, so methods defined after the first reflection are not visible.
+ *
+ */
+static Handle<FunctionTemplate> v8_class_template(VALUE klass)
+{
+  HandleScope scope;
+  rb_sV8Isolate *iso = rb_v8_isolate_current();
+  st_data_t cached;
+
+  if (iso->templates == NULL) {
+    iso->templates = st_init_numtable();
+  } else if (st_lookup(iso->templates, (st_data_t)klass, &cached)) {
+    return Handle<FunctionTemplate>((FunctionTemplate*)cached);
+  }
+
+  Local<FunctionTemplate> tpl = FunctionTemplate::New();
+  Local<Signature> sig = Signature::New(tpl);
+  Local<ObjectTemplate> proto = tpl->PrototypeTemplate();
+  tpl->SetClassName(String::New(rb_class2name(klass)));
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  VALUE meths = rb_funcall2(klass, rb_intern("declared_methods"), 0, NULL);
+  v8_class_reflection *reflection = new v8_class_reflection;
+  VALUE owner = Data_Wrap_Struct(rb_cObject, v8_class_reflection_gc_mark, v8_class_reflection_gc_free, reflection);
+  reflection->klass = klass;
+
+  // Templates point to descriptors, so they can't be moved around...
+  reflection->methods.reserve(RARRAY_LEN(meths));
+
+  for (int_r i = 0; i < RARRAY_LEN(meths); i++) {
+    VALUE name = rb_ary_entry(meths, i);
+    VALUE func_name = rb_funcall2(name, rb_intern("to_js_func_name"), 0, NULL);
+
+    if (!NIL_P(func_name)) {
+      VALUE unbound = rb_funcall2(klass, rb_intern("instance_method"), 1, &name);
+      v8_method meth;
+      meth.id = SYM2ID(name);
+      meth.arity = NUM2INT(rb_funcall2(unbound, rb_intern("arity"), 0, NULL));
+      reflection->methods.push_back(meth);
+
+      Local<FunctionTemplate> func = FunctionTemplate::New(method_caller, External::New(&reflection->methods.back()), sig);
+      proto->Set(String::New(rb_id2name(SYM2ID(func_name))), func);
+    }
+  }
+
+  if (NIL_P(iso->reflections)) {
+    iso->reflections = rb_ary_new();
+  }
+
+  Persistent<FunctionTemplate> persistent = Persistent<FunctionTemplate>::New(tpl);
+  st_insert(iso->templates, (st_data_t)klass, (st_data_t)*persistent);
+  rb_ary_push(iso->reflections, owner);
+  return scope.Close(tpl);
+}
+
 /* Typecasting helpers */
 
+/*
+ * Returns property name for given hash key. Strings and symbols are the
+ * most common keys, so they're converted directly.
+ *
+ */
+static Handle<String> v8_property_name(VALUE key)
+{
+  switch (TYPE(key)) {
+  case T_STRING:
+    return String::New(RSTRING_PTR(key), RSTRING_LEN(key));
+  case T_SYMBOL:
+    return String::New(rb_id2name(SYM2ID(key)));
+  default:
+    return to_v8(key)->ToString();
+  }
+}
+
+static int v8_object_set_pair(VALUE key, VALUE value, VALUE data)
+{
+  HandleScope scope;
+  Handle<Object> obj = *(Handle<Object>*)data;
+  obj->Set(v8_property_name(key), to_v8(value));
+  return ST_CONTINUE;
+}
+
 Handle<Value> to_v8_object(VALUE value)
 {
   HandleScope scope;
-  Local<Object> obj = Object::New();
+  Local<Object> obj;
 
   if (rb_obj_is_kind_of(value, rb_cHash)) {
-    VALUE keys = rb_funcall2(value, rb_intern("keys"), 0, NULL);
-
-    // TODO: for sure there is more efficient way to retrieve all hash
-    // values and keys, some enumerator/iterator?
-    for (int_r i = 0; i < RARRAY_LEN(keys); i++) {
-      VALUE key = rb_ary_entry(keys, i);
-      obj->Set(to_v8(key)->ToString(), to_v8(rb_hash_aref(value, key)));
-    }
+    obj = Object::New();
+    rb_hash_foreach(value, (int (*)(ANYARGS))v8_object_set_pair, (VALUE)&obj);
   } else {
-    obj->SetHiddenValue(String::New("RUBY_OBJECT"), External::Wrap((void*)value));
-    
-    // Rest of conversion stuff is handled in ruby code. Check the lib/v8/object.rb
-    // for details... 
+    obj = v8_class_template(rb_obj_class(value))->GetFunction()->NewInstance();
+    obj->SetPointerInInternalField(0, (void*)value);
+    v8_retain_ruby(obj, value);
   }
   
-  return obj;
+  return scope.Close(obj);
 }
 
 /* V8::Object methods */
@@ -145,18 +309,74 @@ static VALUE rb_v8_object_keys(VALUE self)
   return keys;
 }
 
+/*
+ * call-seq:
+ *   obj.each_pair { |key, value| ... }  => obj
+ *   obj.each { |key, value| ... }       => obj
+ *   obj.each_pair                       => enumerator
+ *
+ * Yields each property name (as ruby string) together with its value.
+ * Properties are fetched one by one while iterating, so breaking out of
+ * the block doesn't convert the rest of them.
+ *
+ */
+static VALUE rb_v8_object_each_pair(VALUE self)
+{
+  RETURN_ENUMERATOR(self, 0, 0);
+  int state = 0;
+
+  {
+    HandleScope scope;
+    Handle<Object> obj = unwrap(self);
+    Handle<Array> keys = obj->GetPropertyNames();
+
+    for (unsigned int i = 0; i < keys->Length() && state == 0; i++) {
+      HandleScope item_scope;
+      Local<Value> key = keys->Get(i);
+      VALUE pair = rb_assoc_new(v8_string_to_utf8(key->ToString()), to_ruby(obj->Get(key)));
+      rb_protect(rb_yield, pair, &state);
+    }
+  }
+
+  // Block can break or raise, so it's rethrown after handle scopes have
+  // been closed...
+  if (state != 0) {
+    rb_jump_tag(state);
+  }
+
+  return self;
+}
+
+/*
+ * call-seq:
+ *   obj.include?(key)  => true or false
+ *   obj.has_key?(key)  => true or false
+ *   obj.key?(key)      => true or false
+ *
+ * Returns <code>true</code> when object has given property.
+ *
+ */
+static VALUE rb_v8_object_include_p(VALUE self, VALUE key)
+{
+  HandleScope scope;
+
+  if (FIXNUM_P(key)) {
+    return unwrap(self)->Has(NUM2UINT(key)) ? Qtrue : Qfalse;
+  } else {
+    return unwrap(self)->Has(v8_property_name(key)) ? Qtrue : Qfalse;
+  }
+}
+
 /* Public constructors */
 
 VALUE rb_v8_object_new2(VALUE data)
 {
-  // Here we have to call #new using rb_funcall because new is extended on
-  // the ruby side. 
-  return rb_funcall2(rb_cV8Object, rb_intern("new"), 1, &data);
+  return rb_v8_object_new(1, &data, rb_cV8Object);
 }
 
 VALUE rb_v8_object_new3()
 {
-  return rb_funcall2(rb_cV8Object, rb_intern("new"), 0, NULL);
+  return rb_v8_object_new(0, NULL, rb_cV8Object);
 }
 
 
@@ -171,4 +391,9 @@ void Init_V8_Object()
   rb_define_method(rb_cV8Object, "set", RUBY_METHOD_FUNC(rb_v8_object_set), 2);
   rb_define_method(rb_cV8Object, "keys", RUBY_METHOD_FUNC(rb_v8_object_keys), 0);
   rb_define_method(rb_cV8Object, "properties", RUBY_METHOD_FUNC(rb_v8_object_keys), 0);
+  rb_define_method(rb_cV8Object, "each_pair", RUBY_METHOD_FUNC(rb_v8_object_each_pair), 0);
+  rb_define_method(rb_cV8Object, "each", RUBY_METHOD_FUNC(rb_v8_object_each_pair), 0);
+  rb_define_method(rb_cV8Object, "include?", RUBY_METHOD_FUNC(rb_v8_object_include_p), 1);
+  rb_define_method(rb_cV8Object, "has_key?", RUBY_METHOD_FUNC(rb_v8_object_include_p), 1);
+  rb_define_method(rb_cV8Object, "key?", RUBY_METHOD_FUNC(rb_v8_object_include_p), 1);
 }
@@ -0,0 +1,98 @@
+#include "v8_main.h"
+#include "v8_string.h"
+#include "v8_profiler.h"
+#include "v8_macros.h"
+
+#include <v8-profiler.h>
+
+using namespace v8;
+
+VALUE rb_mV8Profiler;
+
+/* Local helpers */
+
+/*
+ * Converts given profile node (with all its descendants) into plain ruby
+ * hashes, so profile can be deleted right after conversion and ruby side
+ * doesn't have to care about its lifetime.
+ *
+ */
+static VALUE v8_profile_node_to_hash(const CpuProfileNode *node)
+{
+  HandleScope scope;
+  VALUE hash = rb_hash_new();
+  int line_no = node->GetLineNumber();
+
+  rb_hash_aset(hash, ID2SYM(rb_intern("function_name")), v8_string_to_utf8(node->GetFunctionName()));
+  rb_hash_aset(hash, ID2SYM(rb_intern("script_name")), v8_string_to_utf8(node->GetScriptResourceName()));
+  rb_hash_aset(hash, ID2SYM(rb_intern("line_no")), line_no == CpuProfileNode::kNoLineNumberInfo ? Qnil : INT2NUM(line_no));
+  rb_hash_aset(hash, ID2SYM(rb_intern("self_ticks")), LONG2NUM((long)node->GetSelfSamplesCount()));
+  rb_hash_aset(hash, ID2SYM(rb_intern("total_ticks")), LONG2NUM((long)node->GetTotalSamplesCount()));
+  rb_hash_aset(hash, ID2SYM(rb_intern("self_time")), rb_float_new(node->GetSelfTime()));
+  rb_hash_aset(hash, ID2SYM(rb_intern("total_time")), rb_float_new(node->GetTotalTime()));
+
+  int count = node->GetChildrenCount();
+  VALUE children = rb_ary_new2(count);
+
+  for (int i = 0; i < count; i++) {
+    rb_ary_store(children, i, v8_profile_node_to_hash(node->GetChild(i)));
+  }
+
+  rb_hash_aset(hash, ID2SYM(rb_intern("children")), children);
+  return hash;
+}
+
+/* V8::Profiler methods */
+
+/*
+ * call-seq:
+ *   V8::Profiler.start(title)  => nil
+ *
+ * Starts collecting CPU profile with given title. Profiles with different
+ * titles can be collected at the same time.
+ *
+ */
+static VALUE rb_v8_profiler_start(VALUE self, VALUE title)
+{
+  HandleScope scope;
+  StringValue(title);
+  CpuProfiler::StartProfiling(String::New(RSTRING_PTR(title), RSTRING_LEN(title)));
+  return Qnil;
+}
+
+/*
+ * call-seq:
+ *   V8::Profiler.stop(title)  => tree or nil
+ *
+ * Stops collecting profile with given title, and returns top-down call
+ * tree of sampled functions, made of hashes with following keys:
+ * <code>:function_name</code>, <code>:script_name</code>,
+ * <code>:line_no</code>, <code>:self_ticks</code>, <code>:total_ticks</code>,
+ * <code>:self_time</code>, <code>:total_time</code> (in milliseconds) and
+ * <code>:children</code>. Returns <code>nil</code> when no such profile
+ * has been started.
+ *
+ */
+static VALUE rb_v8_profiler_stop(VALUE self, VALUE title)
+{
+  HandleScope scope;
+  StringValue(title);
+  const CpuProfile *profile = CpuProfiler::StopProfiling(String::New(RSTRING_PTR(title), RSTRING_LEN(title)));
+
+  if (profile == NULL) {
+    return Qnil;
+  }
+
+  VALUE tree = v8_profile_node_to_hash(profile->GetTopDownRoot());
+  const_cast<CpuProfile*>(profile)->Delete();
+  return tree;
+}
+
+
+/* V8::Profiler initializer. */
+void Init_V8_Profiler()
+{
+  rb_mV8Profiler = rb_define_module_under(rb_mV8, "Profiler");
+  rb_define_singleton_method(rb_mV8Profiler, "start", RUBY_METHOD_FUNC(rb_v8_profiler_start), 1);
+  rb_define_singleton_method(rb_mV8Profiler, "stop", RUBY_METHOD_FUNC(rb_v8_profiler_stop), 1);
+}
@@ -0,0 +1,14 @@
+#ifndef __V8_PROFILER_H
+#define __V8_PROFILER_H
+
+#include "v8_main.h"
+
+using namespace v8;
+
+/* V8::Profiler module */
+RUBY_EXTERN VALUE rb_mV8Profiler;
+
+/* API */
+void Init_V8_Profiler();
+
+#endif//__V8_PROFILER_H
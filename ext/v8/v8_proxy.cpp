@@ -0,0 +1,595 @@
+#include "v8_ref.h"
+#include "v8_cast.h"
+#include "v8_object.h"
+#include "v8_proxy.h"
+#include "v8_locker.h"
+#include "v8_errors.h"
+#include "v8_macros.h"
+
+#include <string.h>
+
+using namespace v8;
+
+/* Declared methods of proxied classes, keyed by class. */
+static VALUE proxy_declared_methods = Qnil;
+
+/* Local helpers */
+
+struct v8_proxy_call;
+typedef void (*v8_proxy_func)(v8_proxy_call *call);
+
+/*
+ * Intercepted access to proxied ruby object. It's passed to the ruby side,
+ * where given function performs lookup and sets the result.
+ *
+ */
+struct v8_proxy_call {
+  v8_proxy_call(v8_proxy_func func, Local<Object> holder)
+    : func(func), args(NULL), index(0)
+  {
+    obj = (VALUE)holder->GetPointerFromInternalField(0);
+  }
+  v8_proxy_func func;
+  VALUE obj;
+  const Arguments *args;
+  Local<String> name;
+  uint32_t index;
+  Local<Value> value;
+  Handle<Value> result;
+};
+
+static VALUE v8_proxy_protected(VALUE data)
+{
+  v8_proxy_call *call = (v8_proxy_call*)data;
+  call->func(call);
+  return Qnil;
+}
+
+/*
+ * Performs intercepted access, rescuing all ruby exceptions and rethrowing
+ * them as javascript errors.
+ *
+ */
+static void *v8_proxy_dispatch(void *data)
+{
+  v8_proxy_call *call = (v8_proxy_call*)data;
+  int state = 0;
+
+  rb_protect(v8_proxy_protected, (VALUE)call, &state);
+
+  if (state) {
+    v8_throw_ruby_error(state);
+    call->result = Handle<Value>();
+  }
+
+  return NULL;
+}
+
+static Handle<Value> v8_proxy_intercept(v8_proxy_call &call)
+{
+  // Interceptors are called from javascript, which may be executed without
+  // GVL, so we have to get it back before touching the ruby object...
+  rb_v8_with_gvl(v8_proxy_dispatch, &call);
+  return call.result;
+}
+
+static VALUE v8_proxy_name(Handle<String> name)
+{
+  String::Utf8Value str(name);
+  return rb_str_new(*str, str.length());
+}
+
+/*
+ * Returns key under which given property is stored in proxied hash. String
+ * keys are checked first, then symbols. Returns <code>Qundef</code> when
+ * there is no such key.
+ *
+ */
+static VALUE v8_proxy_hash_key(VALUE hash, VALUE name)
+{
+  if (rb_hash_lookup2(hash, name, Qundef) != Qundef) {
+    return name;
+  }
+
+  // Names sent from javascript are never interned, because each of them
+  // would stay in symbol table forever...
+  ID id = rb_check_id(&name);
+
+  if (id == 0) {
+    return Qundef;
+  }
+
+  VALUE sym = ID2SYM(id);
+  return rb_hash_lookup2(hash, sym, Qundef) != Qundef ? sym : Qundef;
+}
+
+static VALUE v8_proxy_index_key(VALUE hash, uint32_t index)
+{
+  VALUE key = UINT2NUM(index);
+
+  if (rb_hash_lookup2(hash, key, Qundef) != Qundef) {
+    return key;
+  }
+
+  key = rb_obj_as_string(key);
+  return rb_hash_lookup2(hash, key, Qundef) != Qundef ? key : Qundef;
+}
+
+/*
+ * Returns <code>true</code> when given method can be called from javascript.
+ * Only declared methods of object's class are exposed (the same ones which
+ * are reflected by <code>V8::Object.new</code>), so methods inherited from
+ * <code>Object</code> and <code>Kernel</code>, like <code>send</code> or
+ * <code>instance_eval</code>, are never reachable. Declared methods are
+ * looked up once per class, so methods defined later are not visible.
+ *
+ */
+static bool v8_proxy_declared_p(VALUE obj, ID id)
+{
+  VALUE klass = rb_obj_class(obj);
+  VALUE declared = rb_hash_lookup(proxy_declared_methods, klass);
+
+  if (NIL_P(declared)) {
+    VALUE meths = rb_funcall2(klass, rb_intern("declared_methods"), 0, NULL);
+    declared = rb_hash_new();
+
+    for (int_r i = 0; i < RARRAY_LEN(meths); i++) {
+      rb_hash_aset(declared, rb_ary_entry(meths, i), Qtrue);
+    }
+
+    rb_hash_aset(proxy_declared_methods, klass, declared);
+  }
+
+  return RTEST(rb_hash_lookup(declared, ID2SYM(id))) && rb_respond_to(obj, id);
+}
+
+/*
+ * Returns ID of declared ruby method represented by given javascript name,
+ * or zero when there is no such method. It's reverse of the
+ * <code>Symbol#to_js_func_name</code> mapping.
+ *
+ */
+static ID v8_proxy_method_id(VALUE obj, VALUE name)
+{
+  const char *js = RSTRING_PTR(name);
+  long len = RSTRING_LEN(name);
+  VALUE candidates[4];
+  int count = 0;
+
+  candidates[count++] = name;
+
+  if (len > 3 && strncmp(js, "is_", 3) == 0) {
+    candidates[count++] = rb_str_cat2(rb_str_new(js + 3, len - 3), "?");
+  }
+  if (len > 5 && strcmp(js + len - 5, "_bang") == 0) {
+    candidates[count++] = rb_str_cat2(rb_str_new(js, len - 5), "!");
+  }
+  if (len > 4 && strncmp(js, "set_", 4) == 0) {
+    candidates[count++] = rb_str_cat2(rb_str_new(js + 4, len - 4), "=");
+  }
+
+  for (int i = 0; i < count; i++) {
+    // Method can't exist when its name hasn't been interned yet...
+    ID id = rb_check_id(&candidates[i]);
+
+    if (id != 0 && v8_proxy_declared_p(obj, id)) {
+      return id;
+    }
+  }
+
+  return 0;
+}
+
+static Handle<FunctionTemplate> v8_proxy_template();
+
+static void v8_proxy_method_call(v8_proxy_call *call)
+{
+  const Arguments &args = *call->args;
+  ID id = (ID)External::Unwrap(args.Data());
+  VALUE meth_args[args.Length()];
+
+  for (int i = 0; i < args.Length(); i++) {
+    meth_args[i] = to_ruby(args[i]);
+  }
+
+  call->result = to_v8(rb_funcall2(call->obj, id, args.Length(), meth_args));
+}
+
+static Handle<Value> proxy_method_caller(const Arguments &args)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_method_call, args.Holder());
+  call.args = &args;
+  return scope.Close(v8_proxy_intercept(call));
+}
+
+/*
+ * Returns template of function calling given method on proxied object.
+ * Templates are cached per method and isolate, so the same method of all
+ * proxies is represented by the same function.
+ *
+ */
+static Handle<FunctionTemplate> v8_proxy_method(ID id)
+{
+  HandleScope scope;
+  rb_sV8Isolate *iso = rb_v8_isolate_current();
+  st_data_t cached;
+
+  if (iso->proxy_methods == NULL) {
+    iso->proxy_methods = st_init_numtable();
+  } else if (st_lookup(iso->proxy_methods, (st_data_t)id, &cached)) {
+    return Handle<FunctionTemplate>((FunctionTemplate*)cached);
+  }
+
+  Local<Signature> sig = Signature::New(v8_proxy_template());
+  Local<FunctionTemplate> func = FunctionTemplate::New(proxy_method_caller, External::Wrap((void*)id), sig);
+  Persistent<FunctionTemplate> persistent = Persistent<FunctionTemplate>::New(func);
+  st_insert(iso->proxy_methods, (st_data_t)id, (st_data_t)*persistent);
+  return scope.Close(func);
+}
+
+/* Named properties interceptors */
+
+static void v8_proxy_named_get(v8_proxy_call *call)
+{
+  VALUE name = v8_proxy_name(call->name);
+
+  switch (TYPE(call->obj)) {
+  case T_ARRAY:
+    if (strcmp(RSTRING_PTR(name), "length") == 0) {
+      call->result = Integer::New(RARRAY_LEN(call->obj));
+    }
+    return;
+  case T_HASH: {
+    VALUE key = v8_proxy_hash_key(call->obj, name);
+
+    if (key != Qundef) {
+      call->result = to_v8(rb_hash_aref(call->obj, key));
+      return;
+    }
+  }
+  }
+
+  ID id = v8_proxy_method_id(call->obj, name);
+
+  if (id != 0) {
+    call->result = v8_proxy_method(id)->GetFunction();
+  }
+}
+
+static void v8_proxy_named_set(v8_proxy_call *call)
+{
+  VALUE name = v8_proxy_name(call->name);
+
+  switch (TYPE(call->obj)) {
+  case T_ARRAY:
+    return;
+  case T_HASH: {
+    VALUE key = v8_proxy_hash_key(call->obj, name);
+    rb_hash_aset(call->obj, key == Qundef ? name : key, to_ruby(call->value));
+    call->result = call->value;
+    return;
+  }
+  default:
+    VALUE setter = rb_str_cat2(name, "=");
+    ID id = rb_check_id(&setter);
+
+    if (id != 0 && v8_proxy_declared_p(call->obj, id)) {
+      VALUE value = to_ruby(call->value);
+      rb_funcall2(call->obj, id, 1, &value);
+      call->result = call->value;
+    }
+  }
+}
+
+static void v8_proxy_named_query(v8_proxy_call *call)
+{
+  VALUE name = v8_proxy_name(call->name);
+
+  switch (TYPE(call->obj)) {
+  case T_ARRAY:
+    if (strcmp(RSTRING_PTR(name), "length") == 0) {
+      call->result = Integer::New(DontEnum | DontDelete);
+    }
+    return;
+  case T_HASH:
+    if (v8_proxy_hash_key(call->obj, name) != Qundef) {
+      call->result = Integer::New(None);
+      return;
+    }
+  }
+
+  if (v8_proxy_method_id(call->obj, name) != 0) {
+    call->result = Integer::New(DontEnum | DontDelete);
+  }
+}
+
+static void v8_proxy_named_delete(v8_proxy_call *call)
+{
+  if (TYPE(call->obj) == T_HASH) {
+    VALUE key = v8_proxy_hash_key(call->obj, v8_proxy_name(call->name));
+
+    if (key != Qundef) {
+      rb_hash_delete(call->obj, key);
+      call->result = True();
+    }
+  }
+}
+
+static int v8_proxy_push_key(VALUE key, VALUE value, VALUE data)
+{
+  Handle<Array> keys = *(Handle<Array>*)data;
+  VALUE name = rb_obj_as_string(key);
+  keys->Set(keys->Length(), String::New(RSTRING_PTR(name), RSTRING_LEN(name)));
+  return ST_CONTINUE;
+}
+
+static void v8_proxy_named_enum(v8_proxy_call *call)
+{
+  if (TYPE(call->obj) == T_HASH) {
+    Local<Array> keys = Array::New();
+    rb_hash_foreach(call->obj, (int (*)(ANYARGS))v8_proxy_push_key, (VALUE)&keys);
+    call->result = keys;
+  }
+}
+
+static Handle<Value> proxy_named_get(Local<String> name, const AccessorInfo &info)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_named_get, info.Holder());
+  call.name = name;
+  return scope.Close(v8_proxy_intercept(call));
+}
+
+static Handle<Value> proxy_named_set(Local<String> name, Local<Value> value, const AccessorInfo &info)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_named_set, info.Holder());
+  call.name = name;
+  call.value = value;
+  return scope.Close(v8_proxy_intercept(call));
+}
+
+static Handle<Integer> proxy_named_query(Local<String> name, const AccessorInfo &info)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_named_query, info.Holder());
+  call.name = name;
+  return scope.Close(Handle<Integer>::Cast(v8_proxy_intercept(call)));
+}
+
+static Handle<Boolean> proxy_named_delete(Local<String> name, const AccessorInfo &info)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_named_delete, info.Holder());
+  call.name = name;
+  Handle<Value> result = v8_proxy_intercept(call);
+  return scope.Close(Handle<Boolean>((Boolean*)*result));
+}
+
+static Handle<Array> proxy_named_enum(const AccessorInfo &info)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_named_enum, info.Holder());
+  return scope.Close(Handle<Array>::Cast(v8_proxy_intercept(call)));
+}
+
+/* Indexed properties interceptors */
+
+static void v8_proxy_indexed_get(v8_proxy_call *call)
+{
+  switch (TYPE(call->obj)) {
+  case T_ARRAY:
+    if (call->index < (uint32_t)RARRAY_LEN(call->obj)) {
+      call->result = to_v8(rb_ary_entry(call->obj, call->index));
+    }
+    return;
+  case T_HASH: {
+    VALUE key = v8_proxy_index_key(call->obj, call->index);
+
+    if (key != Qundef) {
+      call->result = to_v8(rb_hash_aref(call->obj, key));
+    }
+  }
+  }
+}
+
+static void v8_proxy_indexed_set(v8_proxy_call *call)
+{
+  switch (TYPE(call->obj)) {
+  case T_ARRAY:
+    rb_ary_store(call->obj, call->index, to_ruby(call->value));
+    call->result = call->value;
+    return;
+  case T_HASH: {
+    VALUE key = v8_proxy_index_key(call->obj, call->index);
+    key = key == Qundef ? rb_obj_as_string(UINT2NUM(call->index)) : key;
+    rb_hash_aset(call->obj, key, to_ruby(call->value));
+    call->result = call->value;
+  }
+  }
+}
+
+static void v8_proxy_indexed_query(v8_proxy_call *call)
+{
+  switch (TYPE(call->obj)) {
+  case T_ARRAY:
+    if (call->index < (uint32_t)RARRAY_LEN(call->obj)) {
+      call->result = Integer::New(None);
+    }
+    return;
+  case T_HASH:
+    if (v8_proxy_index_key(call->obj, call->index) != Qundef) {
+      call->result = Integer::New(None);
+    }
+  }
+}
+
+static void v8_proxy_indexed_delete(v8_proxy_call *call)
+{
+  switch (TYPE(call->obj)) {
+  case T_ARRAY:
+    // Javascript leaves a hole in place of deleted item...
+    if (call->index < (uint32_t)RARRAY_LEN(call->obj)) {
+      rb_ary_store(call->obj, call->index, Qnil);
+      call->result = True();
+    }
+    return;
+  case T_HASH: {
+    VALUE key = v8_proxy_index_key(call->obj, call->index);
+
+    if (key != Qundef) {
+      rb_hash_delete(call->obj, key);
+      call->result = True();
+    }
+  }
+  }
+}
+
+static void v8_proxy_indexed_enum(v8_proxy_call *call)
+{
+  if (TYPE(call->obj) == T_ARRAY) {
+    int_r len = RARRAY_LEN(call->obj);
+    Local<Array> keys = Array::New(len);
+
+    for (int_r i = 0; i < len; i++) {
+      keys->Set(i, Integer::New(i));
+    }
+
+    call->result = keys;
+  }
+}
+
+static Handle<Value> proxy_indexed_get(uint32_t index, const AccessorInfo &info)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_indexed_get, info.Holder());
+  call.index = index;
+  return scope.Close(v8_proxy_intercept(call));
+}
+
+static Handle<Value> proxy_indexed_set(uint32_t index, Local<Value> value, const AccessorInfo &info)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_indexed_set, info.Holder());
+  call.index = index;
+  call.value = value;
+  return scope.Close(v8_proxy_intercept(call));
+}
+
+static Handle<Integer> proxy_indexed_query(uint32_t index, const AccessorInfo &info)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_indexed_query, info.Holder());
+  call.index = index;
+  return scope.Close(Handle<Integer>::Cast(v8_proxy_intercept(call)));
+}
+
+static Handle<Boolean> proxy_indexed_delete(uint32_t index, const AccessorInfo &info)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_indexed_delete, info.Holder());
+  call.index = index;
+  Handle<Value> result = v8_proxy_intercept(call);
+  return scope.Close(Handle<Boolean>((Boolean*)*result));
+}
+
+static Handle<Array> proxy_indexed_enum(const AccessorInfo &info)
+{
+  HandleScope scope;
+  v8_proxy_call call(v8_proxy_indexed_enum, info.Holder());
+  return scope.Close(Handle<Array>::Cast(v8_proxy_intercept(call)));
+}
+
+/*
+ * Returns template of proxy objects, created once per isolate. Proxy keeps
+ * ruby object in internal field and resolves all properties lazily, on
+ * access.
+ *
+ */
+static Handle<FunctionTemplate> v8_proxy_template()
+{
+  rb_sV8Isolate *iso = rb_v8_isolate_current();
+
+  if (iso->proxy_template.IsEmpty()) {
+    HandleScope scope;
+    Local<FunctionTemplate> tpl = FunctionTemplate::New();
+    Local<ObjectTemplate> inst = tpl->InstanceTemplate();
+
+    tpl->SetClassName(String::New("RubyObject"));
+    inst->SetInternalFieldCount(1);
+    inst->SetNamedPropertyHandler(proxy_named_get, proxy_named_set, proxy_named_query,
+				  proxy_named_delete, proxy_named_enum);
+    inst->SetIndexedPropertyHandler(proxy_indexed_get, proxy_indexed_set, proxy_indexed_query,
+				    proxy_indexed_delete, proxy_indexed_enum);
+
+    iso->proxy_template = Persistent<FunctionTemplate>::New(tpl);
+  }
+
+  return iso->proxy_template;
+}
+
+/* Typecasting helpers */
+
+Handle<Value> to_v8_proxy(VALUE value)
+{
+  HandleScope scope;
+  Local<Object> obj = v8_proxy_template()->GetFunction()->NewInstance();
+  obj->SetPointerInInternalField(0, (void*)value);
+  v8_retain_ruby(obj, value);
+
+  // Generic Array.prototype methods work fine with anything what has length
+  // and indexed properties, so proxied arrays can use them as well.
+  if (TYPE(value) == T_ARRAY) {
+    obj->SetPrototype(Array::New()->GetPrototype());
+  }
+
+  return scope.Close(obj);
+}
+
+/* V8::Object methods */
+
+/*
+ * call-seq:
+ *   V8::Object.proxy(obj)  => new_object
+ *
+ * Returns V8 object which proxies all property access to given ruby object,
+ * without copying anything. Hash keys, array items and methods are resolved
+ * lazily, so even huge collections are exposed in constant time. Changes
+ * made from javascript are applied directly to proxied object.
+ *
+ *   cxt[:items] = V8::Object.proxy((1..1_000_000).to_a)
+ *   cxt.eval("items.length", "<eval>") # => 1000000
+ *   cxt.eval("items[10]", "<eval>")    # => 11
+ *
+ * Note that nested collections are copied when accessed, unless they're
+ * proxied explicitly as well.
+ *
+ */
+static VALUE rb_v8_object_proxy(VALUE klass, VALUE data)
+{
+  HandleScope scope;
+  PREVENT_CREATION_WITHOUT_CONTEXT();
+
+  Handle<Object> obj = Handle<Object>::Cast(to_v8_proxy(data));
+  VALUE self = rb_v8_wrapper_new(rb_cV8Object, obj);
+  v8_set_peer2(obj, self);
+  return self;
+}
+
+/* Public constructors */
+
+VALUE rb_v8_proxy_new2(VALUE data)
+{
+  return rb_v8_object_proxy(rb_cV8Object, data);
+}
+
+
+/* V8::Object proxies initializer. */
+void Init_V8_Proxy()
+{
+  proxy_declared_methods = rb_hash_new();
+  rb_gc_register_address(&proxy_declared_methods);
+
+  rb_define_singleton_method(rb_cV8Object, "proxy", RUBY_METHOD_FUNC(rb_v8_object_proxy), 1);
+}
@@ -0,0 +1,13 @@
+#ifndef __V8_PROXY_H
+#define __V8_PROXY_H
+
+#include "v8_main.h"
+
+using namespace v8;
+
+/* API */
+Handle<Value> to_v8_proxy(VALUE value);
+VALUE rb_v8_proxy_new2(VALUE data);
+void Init_V8_Proxy();
+
+#endif//__V8_PROXY_H
@@ -2,11 +2,28 @@
 #include "v8_cast.h"
 #include "v8_external.h"
 
+#include <vector>
+
 using namespace v8;
 
+/* All ruby objects referenced from V8 heaps. */
+static std::vector<rb_sV8Retained*> retained;
+
+/* Keeps retained objects marked during ruby's GC. */
+static VALUE retained_keeper = Qnil;
+
+/*
+ * Live objects counters. Peers and retained objects can be released by V8's
+ * GC without GVL, so they're updated atomically.
+ *
+ */
+static long live_wrappers = 0;
+static volatile long live_peers = 0;
+static volatile long live_retained = 0;
+
 void rb_v8_wrapper_gc_mark(rb_sV8Wrapper *r)
 {
-  rb_gc_mark(r->references);
+  r->mark();
 }
 
 void rb_v8_wrapper_gc_free(rb_sV8Wrapper *r)
@@ -14,6 +31,65 @@ void rb_v8_wrapper_gc_free(rb_sV8Wrapper *r)
   delete r;
 }
 
+/*
+ * Marks ruby objects which are still referenced from V8, and forgets about
+ * the ones whose referrers have been collected in the meantime.
+ *
+ */
+static void rb_v8_retained_gc_mark(std::vector<rb_sV8Retained*> *list)
+{
+  size_t live = 0;
+
+  for (size_t i = 0; i < list->size(); i++) {
+    rb_sV8Retained *ref = (*list)[i];
+
+    if (ref->alive) {
+      rb_gc_mark(ref->obj);
+      (*list)[live++] = ref;
+    } else {
+      delete ref;
+    }
+  }
+
+  list->resize(live);
+}
+
+/*
+ * Rough estimation of memory used by given ruby object, reported to V8 so
+ * it can see pressure coming from ruby's heap.
+ *
+ */
+static int rb_v8_memsize(VALUE obj)
+{
+  int size = sizeof(VALUE) * 5;
+
+  switch (TYPE(obj)) {
+  case T_STRING:
+    return size + RSTRING_LEN(obj);
+  case T_ARRAY:
+    return size + RARRAY_LEN(obj) * sizeof(VALUE);
+  default:
+    return size;
+  }
+}
+
+/* Called by V8's GC when referrer of retained ruby object is collected. */
+static void v8_retained_weak_callback(Persistent<Value> object, void *data)
+{
+  rb_sV8Retained *ref = (rb_sV8Retained*)data;
+  ref->handle.Dispose();
+  v8_release(ref);
+}
+
+/* Called by V8's GC when object with ruby peer is collected. */
+static void v8_peer_weak_callback(Persistent<Value> object, void *data)
+{
+  rb_sV8Peer *peer = (rb_sV8Peer*)data;
+  peer->handle.Dispose();
+  delete peer;
+  __sync_sub_and_fetch(&live_peers, 1);
+}
+
 /*
  * Creates new reference to V8 object for ruby object.
  *
@@ -31,45 +107,268 @@ VALUE rb_v8_wrapper_new(VALUE klass, Handle<void> handle)
  * Appends additional reference to ruby object wrapped with v8_wrapper.
  *
  */
-void rb_v8_wrapper_aset(VALUE obj, const char *name, VALUE ref)
+void rb_v8_wrapper_aset(VALUE obj, ID name, VALUE ref)
 {
   rb_sV8Wrapper *r = 0;
   Data_Get_Struct(obj, struct rb_sV8Wrapper, r);
   r->set(name, ref);
 }
 
+void rb_v8_wrapper_aset(VALUE obj, const char *name, VALUE ref)
+{
+  rb_v8_wrapper_aset(obj, rb_intern(name), ref);
+}
+
 /*
  * Returns specified referenced ruby object wrapped with v8_wrapper. 
  *
  */
-VALUE rb_v8_wrapper_aref(VALUE obj, const char *name)
+VALUE rb_v8_wrapper_aref(VALUE obj, ID name)
 {
   rb_sV8Wrapper *r = 0;
   Data_Get_Struct(obj, struct rb_sV8Wrapper, r);
   return r->get(name);
 }
 
+VALUE rb_v8_wrapper_aref(VALUE obj, const char *name)
+{
+  return rb_v8_wrapper_aref(obj, rb_intern(name));
+}
+
+/*
+ * Replaces V8 object referenced by ruby object wrapped with v8_wrapper.
+ *
+ */
+void rb_v8_wrapper_reset(VALUE obj, Handle<void> handle)
+{
+  rb_sV8Wrapper *r = 0;
+  Data_Get_Struct(obj, struct rb_sV8Wrapper, r);
+  r->reset(handle);
+}
+
+/*
+ * Assigns ruby peer object to reflected V8 object, so it will be reused
+ * each time when the same V8 object is reflected. Peer is referenced weakly
+ * from both sides, and doesn't keep V8 object alive when ruby one is gone.
+ *
+ */
+void v8_set_peer2(Handle<Object> handle, VALUE obj)
+{
+  HandleScope scope;
+  Handle<String> key = v8_peer_key();
+  Local<Value> hidden = handle->GetHiddenValue(key);
+  rb_sV8Peer *peer;
+
+  if (hidden.IsEmpty()) {
+    peer = new rb_sV8Peer();
+    peer->handle = Persistent<Object>::New(handle);
+    peer->handle.MakeWeak(peer, v8_peer_weak_callback);
+    handle->SetHiddenValue(key, External::Wrap(peer));
+    __sync_add_and_fetch(&live_peers, 1);
+  } else {
+    peer = (rb_sV8Peer*)External::Unwrap(hidden);
+  }
+
+  rb_sV8Wrapper *r = 0;
+  Data_Get_Struct(obj, struct rb_sV8Wrapper, r);
+  peer->obj = obj;
+  peer->owner = r;
+  r->peer = peer;
+}
+
+/*
+ * Returns ruby peer of given V8 object, or <code>Qnil</code> when there is
+ * no peer or it has been already collected. With lazy sweep peer can be
+ * found dead (not marked) before its wrapper is freed, so it's not handed
+ * out then, and new wrapper takes its place.
+ *
+ */
+VALUE v8_get_peer(Handle<Object> handle)
+{
+  HandleScope scope;
+  Local<Value> hidden = handle->GetHiddenValue(v8_peer_key());
+
+  if (hidden.IsEmpty()) {
+    return Qnil;
+  }
+
+  VALUE obj = ((rb_sV8Peer*)External::Unwrap(hidden))->obj;
+
+  if (NIL_P(obj) || rb_objspace_garbage_object_p(obj)) {
+    return Qnil;
+  }
+
+  return obj;
+}
+
+/*
+ * Protects given ruby object from ruby's GC until returned reference is
+ * released with <code>v8_release</code>. Memory used by the object is
+ * reported to V8 as external allocation.
+ *
+ */
+rb_sV8Retained *v8_retain(VALUE obj)
+{
+  if (NIL_P(retained_keeper)) {
+    retained_keeper = Data_Wrap_Struct(rb_cObject, rb_v8_retained_gc_mark, 0, &retained);
+    rb_gc_register_address(&retained_keeper);
+  }
+
+  rb_sV8Retained *ref = new rb_sV8Retained();
+  ref->isolate = Isolate::GetCurrent();
+  ref->obj = obj;
+  ref->size = rb_v8_memsize(obj);
+  ref->alive = true;
+  retained.push_back(ref);
+  __sync_add_and_fetch(&live_retained, 1);
+
+  V8::AdjustAmountOfExternalAllocatedMemory(ref->size);
+  return ref;
+}
+
+/*
+ * Releases retained ruby object. It doesn't touch ruby stuff, so it can be
+ * called from within V8's GC, even without GVL.
+ *
+ */
+void v8_release(rb_sV8Retained *ref)
+{
+  // Already released together with its isolate...
+  if (!ref->alive) {
+    return;
+  }
+
+  V8::AdjustAmountOfExternalAllocatedMemory(-ref->size);
+  __sync_sub_and_fetch(&live_retained, 1);
+
+  // It has to be the last touch, the ref can be freed by ruby's GC
+  // right after that...
+  ref->alive = false;
+}
+
+/*
+ * Protects given ruby object from ruby's GC as long as referrer lives
+ * within V8 heap.
+ *
+ *   v8_retain_ruby(func, proc);
+ *
+ */
+void v8_retain_ruby(Handle<Object> referrer, VALUE obj)
+{
+  rb_sV8Retained *ref = v8_retain(obj);
+  ref->handle = Persistent<Object>::New(referrer);
+  ref->handle.MakeWeak(ref, v8_retained_weak_callback);
+}
+
+/*
+ * Releases all ruby objects referenced from given isolate. Weak callbacks
+ * are not called when isolate is disposed, so it have to be done explicitly.
+ *
+ */
+void v8_release_retained(Isolate *isolate)
+{
+  for (size_t i = 0; i < retained.size(); i++) {
+    if (retained[i]->isolate == isolate && retained[i]->alive) {
+      __sync_sub_and_fetch(&live_retained, 1);
+      retained[i]->alive = false;
+    }
+  }
+}
+
+/* Fills given struct with current numbers of live objects. */
+void v8_wrapper_stats(rb_sV8WrapperStats *stats)
+{
+  stats->wrappers = live_wrappers;
+  stats->peers = live_peers;
+  stats->retained = live_retained;
+}
+
 /* The v8_wrapper struct methods. */
 
 rb_sV8Wrapper::rb_sV8Wrapper(Handle<void> object)
+  : peer(NULL), refs(NULL), refs_count(0)
 {
+  isolate = rb_v8_isolate_current();
+  isolate->dispose_garbage();
+  isolate->retain();
   handle = Persistent<void>::New(object);
-  references = rb_hash_new();
+  tag();
+  live_wrappers++;
 }
 
 rb_sV8Wrapper::~rb_sV8Wrapper()
 {
-  handle.Dispose();
+  // Handle can't be disposed when owning isolate is used by other thread,
+  // so we let the isolate decide...
+  isolate->release(handle);
+  xfree(refs);
+  live_wrappers--;
+
+  // Peer can be already taken over by newer wrapper of the same object,
+  // and then it's not ours to clear...
+  if (peer != NULL && peer->owner == this) {
+    peer->obj = Qnil;
+    peer->owner = NULL;
+  }
+}
+
+void rb_sV8Wrapper::reset(Handle<void> object)
+{
+  isolate->retain();
+  isolate->release(handle);
+  handle = Persistent<void>::New(object);
+  tag();
+}
+
+/*
+ * Marks handle of wrapped object with wrapper class id, so heap snapshots
+ * can tell which objects are kept alive by ruby wrappers.
+ *
+ */
+void rb_sV8Wrapper::tag()
+{
+  Persistent<Value> value((Value*)*handle);
+
+  // Only heap objects can be reported, other values (eg. small integers or
+  // contexts) are left untagged...
+  if (value->IsObject()) {
+    value.SetWrapperClassId(V8_WRAPPER_CLASS_ID);
+  }
 }
 
-void rb_sV8Wrapper::set(const char *name, VALUE ref)
+void rb_sV8Wrapper::set(ID name, VALUE ref)
 {
   if (ref != 0 && RTEST(ref) && !NIL_P(ref)) {
-    rb_hash_aset(references, rb_str_new2(name), ref);
+    for (unsigned int i = 0; i < refs_count; i++) {
+      if (refs[i].name == name) {
+        refs[i].value = ref;
+        return;
+      }
+    }
+
+    REALLOC_N(refs, rb_sV8WrapperRef, refs_count + 1);
+    refs[refs_count].name = name;
+    refs[refs_count].value = ref;
+    refs_count++;
+  }
+}
+
+VALUE rb_sV8Wrapper::get(ID name)
+{
+  for (unsigned int i = 0; i < refs_count; i++) {
+    if (refs[i].name == name) {
+      return refs[i].value;
+    }
   }
+
+  return Qnil;
 }
 
-VALUE rb_sV8Wrapper::get(const char *name)
+void rb_sV8Wrapper::mark()
 {
-  return rb_hash_aref(references, rb_str_new2(name));
+  for (unsigned int i = 0; i < refs_count; i++) {
+    rb_gc_mark(refs[i].value);
+  }
+
+  rb_gc_mark(isolate->self);
 }
@@ -3,40 +3,100 @@
 
 #include <ruby.h>
 #include <v8.h>
+#include "v8_isolate.h"
 
 using namespace v8;
 
 /* Names of hidden values which contains ruby peer object. */
 #define RUBY_PEER_ATTR "__RUBY_PEER__"
 
+/* Class id of wrappers' persistent handles, used by heap snapshots. */
+#define V8_WRAPPER_CLASS_ID 0x4d67
+
 /* Assigns ruby peer object as hidden value of reflected v8 object. */
-#define v8_set_peer2(handle, obj) \
-  handle->SetHiddenValue(String::New(RUBY_PEER_ATTR), External::Wrap((void*)obj))
 #define v8_set_peer(obj) \
   v8_set_peer2(unwrap(obj), obj)
 
+/*
+ * Link between V8 object and its ruby peer. It lives as long as the V8 object,
+ * and it's cleared when peer is collected by ruby's GC, so the V8 object never
+ * points to freed ruby object.
+ *
+ */
+struct rb_sV8Wrapper;
+
+struct rb_sV8Peer {
+  VALUE obj;
+  rb_sV8Wrapper *owner;
+  Persistent<Object> handle;
+};
+
+/*
+ * Ruby object referenced from V8 heap. It's protected from ruby's GC until
+ * the referrer is collected by V8.
+ *
+ */
+struct rb_sV8Retained {
+  Isolate *isolate;
+  VALUE obj;
+  int size;
+  volatile bool alive;
+  Persistent<Object> handle;
+};
+
+/* Additional ruby object referenced by wrapper, keyed by interned name. */
+struct rb_sV8WrapperRef {
+  ID name;
+  VALUE value;
+};
+
 /*
  * The objectRef keeps a persistent V8 handle, so ruby object can access
- * a reference to it.
+ * a reference to it. Most of wrappers never keep any additional references,
+ * so slots for them are allocated lazily, on first set.
  *
  */
 struct rb_sV8Wrapper {
   rb_sV8Wrapper(Handle<void> object);
-  virtual ~rb_sV8Wrapper();
-  void set(const char *name, VALUE ref);
-  VALUE get(const char *name);
+  ~rb_sV8Wrapper();
+  void reset(Handle<void> object);
+  void tag();
+  void set(ID name, VALUE ref);
+  VALUE get(ID name);
+  void mark();
   Persistent<void> handle;
-  VALUE references;
+  rb_sV8Isolate *isolate;
+  rb_sV8Peer *peer;
+  rb_sV8WrapperRef *refs;
+  unsigned int refs_count;
+};
+
+/* Numbers of live wrappers, peers and ruby objects retained by V8. */
+struct rb_sV8WrapperStats {
+  long wrappers;
+  long peers;
+  long retained;
 };
 
 /* API */
 VALUE rb_v8_wrapper_new(VALUE obj, Handle<void> handle);
 void rb_v8_wrapper_aset(VALUE obj, const char *name, VALUE ref);
+void rb_v8_wrapper_aset(VALUE obj, ID name, VALUE ref);
 VALUE rb_v8_wrapper_aref(VALUE obj, const char *name);
+VALUE rb_v8_wrapper_aref(VALUE obj, ID name);
+void rb_v8_wrapper_reset(VALUE obj, Handle<void> handle);
+void v8_set_peer2(Handle<Object> handle, VALUE obj);
+VALUE v8_get_peer(Handle<Object> handle);
+rb_sV8Retained *v8_retain(VALUE obj);
+void v8_release(rb_sV8Retained *ref);
+void v8_retain_ruby(Handle<Object> referrer, VALUE obj);
+void v8_release_retained(Isolate *isolate);
+void v8_wrapper_stats(rb_sV8WrapperStats *stats);
 
 /*
  * Gets reference to V8 object from related ruby object, and reflects
- * it to specified type.
+ * it to specified type. Raises error when object's isolate has been
+ * disposed, because its handle points to freed memory then.
  *
  *   v8_handle_from_wrapper<String>(rb_str_value);
  *   v8_handle_from_wrapper<Integer>(rb_int_value);
@@ -46,6 +106,11 @@ template <class T> Local<T> v8_handle_from_wrapper(VALUE obj)
 {
   rb_sV8Wrapper* r = 0;
   Data_Get_Struct(obj, struct rb_sV8Wrapper, r);
+
+  if (r->isolate->disposed) {
+    rb_raise(rb_eRuntimeError, "can't use V8 object which belongs to disposed isolate");
+  }
+
   return (T*)*r->handle;
 }
 
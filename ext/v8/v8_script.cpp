@@ -0,0 +1,373 @@
+#include "v8_ref.h"
+#include "v8_cast.h"
+#include "v8_base.h"
+#include "v8_script.h"
+#include "v8_errors.h"
+#include "v8_locker.h"
+#include "v8_macros.h"
+
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+
+using namespace v8;
+
+VALUE rb_cV8Script;
+UNWRAPPER(Script);
+
+/* Local helpers */
+
+/*
+ * Compiles given source into context independent script. When preparse data
+ * is given then it's used to skip the parsing phase.
+ *
+ */
+static Local<Script> v8_script_compile(VALUE source, VALUE filename, VALUE data)
+{
+  HandleScope scope;
+  Local<String> _source(String::New(RSTRING_PTR(source), RSTRING_LEN(source)));
+  ScriptOrigin origin(String::New(StringValuePtr(filename)));
+  ScriptData *pre_data = NULL;
+
+  if (!NIL_P(data)) {
+    pre_data = ScriptData::New(RSTRING_PTR(data), RSTRING_LEN(data));
+  }
+
+  Local<Script> script = Script::New(_source, &origin, pre_data);
+  delete pre_data;
+  return scope.Close(script);
+}
+
+struct v8_script_run_args {
+  Handle<Script> script;
+  Local<Value> result;
+};
+
+static void *v8_script_run_nogvl(void *data)
+{
+  v8_script_run_args *args = (v8_script_run_args*)data;
+  args->result = args->script->Run();
+  return NULL;
+}
+
+/*
+ * Watchdog thread, which terminates javascript execution in given isolate
+ * when it's not finished before the deadline. It doesn't touch ruby at all,
+ * so it can fire while script runs with or without GVL.
+ *
+ */
+struct v8_watchdog {
+  Isolate *isolate;
+  struct timespec deadline;
+  bool done;
+  bool fired;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  pthread_t thread;
+};
+
+static void *v8_watchdog_loop(void *data)
+{
+  v8_watchdog *w = (v8_watchdog*)data;
+  pthread_mutex_lock(&w->mutex);
+
+  while (!w->done) {
+    if (pthread_cond_timedwait(&w->cond, &w->mutex, &w->deadline) == ETIMEDOUT && !w->done) {
+      w->fired = true;
+      V8::TerminateExecution(w->isolate);
+      break;
+    }
+  }
+
+  pthread_mutex_unlock(&w->mutex);
+  return NULL;
+}
+
+/*
+ * Deadlines are measured with monotonic clock where condition variables can
+ * use it, so changes of system time don't fire watchdog too early or late.
+ *
+ */
+#ifdef HAVE_PTHREAD_CONDATTR_SETCLOCK
+#define V8_WATCHDOG_CLOCK CLOCK_MONOTONIC
+#else
+#define V8_WATCHDOG_CLOCK CLOCK_REALTIME
+#endif
+
+static bool v8_watchdog_start(v8_watchdog *w, double timeout)
+{
+  clock_gettime(V8_WATCHDOG_CLOCK, &w->deadline);
+  long nsec = w->deadline.tv_nsec + (long)((timeout - (long)timeout) * 1e9);
+  w->deadline.tv_sec += (time_t)timeout + nsec / 1000000000L;
+  w->deadline.tv_nsec = nsec % 1000000000L;
+  w->isolate = Isolate::GetCurrent();
+  w->done = false;
+  w->fired = false;
+  pthread_mutex_init(&w->mutex, NULL);
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+#ifdef HAVE_PTHREAD_CONDATTR_SETCLOCK
+  pthread_condattr_setclock(&attr, V8_WATCHDOG_CLOCK);
+#endif
+  pthread_cond_init(&w->cond, &attr);
+  pthread_condattr_destroy(&attr);
+
+  if (pthread_create(&w->thread, NULL, v8_watchdog_loop, w) != 0) {
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->mutex);
+    return false;
+  }
+
+  return true;
+}
+
+/* Stops watchdog and returns <code>true</code> when it has fired. */
+static bool v8_watchdog_stop(v8_watchdog *w)
+{
+  pthread_mutex_lock(&w->mutex);
+  w->done = true;
+  pthread_cond_signal(&w->cond);
+  pthread_mutex_unlock(&w->mutex);
+  pthread_join(w->thread, NULL);
+  pthread_cond_destroy(&w->cond);
+  pthread_mutex_destroy(&w->mutex);
+  return w->fired;
+}
+
+/* Number of javascript executions nested within current thread. */
+static __thread int execution_depth = 0;
+
+/* Whether any watchdog fired since the outermost execution started. */
+static __thread bool execution_timed_out = false;
+
+int v8_execution_depth()
+{
+  return execution_depth;
+}
+
+/*
+ * Executes javascript with given function, within currently entered
+ * context. When current thread holds the V8 lock then it's executed without
+ * ruby's GVL.
+ *
+ * When positive timeout (in seconds) is given, then execution is guarded
+ * by watchdog, and terminated once it takes longer than that. Terminated
+ * execution is caught by surrounding <code>TryCatch</code>, which can't
+ * continue then.
+ *
+ * Termination applies to all javascript running within the isolate, so
+ * timeout of execution nested in ruby callback propagates and terminates
+ * outer executions as well.
+ *
+ */
+void v8_execute(void *(*func)(void*), void *data, double timeout)
+{
+  v8_watchdog watchdog;
+  bool guarded = timeout > 0 && v8_watchdog_start(&watchdog, timeout);
+
+  execution_depth++;
+  rb_v8_without_gvl(func, data);
+  execution_depth--;
+
+  if (guarded && v8_watchdog_stop(&watchdog)) {
+    execution_timed_out = true;
+  }
+
+  if (execution_depth == 0 && (execution_timed_out || v8_ruby_jump_pending())) {
+    // When execution finished right before termination took effect, then
+    // it's still pending and would kill next run within this isolate. We
+    // have to consume it here, running dummy code. It can be done only
+    // when there is no javascript left on the stack...
+    execution_timed_out = false;
+    HandleScope scope;
+    TryCatch try_catch;
+    Script::Compile(String::New("0"))->Run();
+  }
+}
+
+/*
+ * Runs given script within currently entered context, the same way as
+ * <code>v8_execute</code> does.
+ *
+ */
+Local<Value> v8_script_run(Handle<Script> script, double timeout)
+{
+  v8_script_run_args args;
+  args.script = script;
+  v8_execute(v8_script_run_nogvl, &args, timeout);
+  return args.result;
+}
+
+/* V8::Script methods */
+
+/*
+ * call-seq:
+ *   V8::Script.precompile(source)  => data or nil
+ *
+ * Preparses given source and returns serialized preparse data, which can
+ * be passed later to <code>V8::Script.new</code>. Returns <code>nil</code>
+ * when given source can't be parsed. Doesn't require entered context.
+ *
+ */
+static VALUE rb_v8_script_precompile_m(VALUE klass, VALUE source)
+{
+  return rb_v8_script_precompile(source);
+}
+
+/*
+ * call-seq:
+ *   V8::Script.new(source)                  => new_script
+ *   V8::Script.new(source, filename)        => new_script
+ *   V8::Script.new(source, filename, data)  => new_script
+ *
+ * Compiles given source once, so it can be run many times later in any
+ * context. When no preparse data given then it's precompiled here and kept
+ * within the script. If source is broken then proper JavaScript error will
+ * be returned.
+ *
+ *   script = V8::Script.new("1+1", "script.js")
+ *   script.run # => 2
+ *   script.run # => 2
+ *
+ */
+static VALUE rb_v8_script_new(int argc, VALUE *argv, VALUE klass)
+{
+  HandleScope scope;
+  PREVENT_CREATION_WITHOUT_CONTEXT();
+
+  if (argc < 1 || argc > 3) {
+    rb_raise(rb_eArgError, "wrong number of arguments (%d for 1..3)", argc);
+    return Qnil;
+  }
+
+  VALUE source = StringValue(argv[0]);
+  VALUE filename = argc > 1 ? argv[1] : rb_str_new2("<eval>");
+  VALUE data = argc > 2 ? argv[2] : Qnil;
+
+  if (NIL_P(data)) {
+    data = rb_v8_script_precompile(source);
+  } else {
+    StringValue(data);
+  }
+
+  TryCatch try_catch;
+  Local<Script> script = v8_script_compile(source, filename, data);
+
+  if (try_catch.HasCaught()) {
+    return rb_v8_error_new3(try_catch);
+  }
+
+  VALUE self = rb_v8_wrapper_new(klass, script);
+  rb_iv_set(self, "@filename", filename);
+  rb_iv_set(self, "@data", data);
+  rb_iv_set(self, "@context", Qnil);
+  return self;
+}
+
+/*
+ * Script#run implementation. It's kept apart, so all V8 scopes are closed
+ * before ruby jump from within the script is carried out.
+ *
+ */
+static VALUE v8_script_run_scoped(int argc, VALUE *argv, VALUE self)
+{
+  HandleScope scope;
+
+  if (argc > 2) {
+    rb_raise(rb_eArgError, "wrong number of arguments (%d for 0..2)", argc);
+    return Qnil;
+  }
+
+  VALUE cxt = argc > 0 && !NIL_P(argv[0]) ? argv[0] : rb_iv_get(self, "@context");
+  double timeout = argc > 1 && !NIL_P(argv[1]) ? NUM2DBL(argv[1]) : 0;
+
+  if (!NIL_P(cxt)) {
+    rb_funcall2(cxt, rb_intern("enter"), 0, NULL);
+  } else if (!Context::InContext()) {
+    rb_raise(rb_eRuntimeError, "can't run V8 script without entering into context");
+    return Qnil;
+  }
+
+  TryCatch try_catch;
+  Local<Value> result = v8_script_run(unwrap(self), timeout);
+
+  if (try_catch.HasCaught()) {
+    return rb_v8_error_new3(try_catch);
+  } else {
+    return to_ruby(result);
+  }
+}
+
+/*
+ * call-seq:
+ *   script.run                => result
+ *   script.run(cxt)           => result
+ *   script.run(cxt, timeout)  => result
+ *
+ * Runs compiled script within given, bound or currently entered context.
+ * When script breaks then proper JavaScript error will be returned. When
+ * timeout (in seconds) is given, then execution is terminated once it takes
+ * longer than that, and <code>V8::TimeoutError</code> is returned.
+ *
+ */
+static VALUE rb_v8_script_run(int argc, VALUE *argv, VALUE self)
+{
+  VALUE result = v8_script_run_scoped(argc, argv, self);
+  v8_rethrow_ruby_jump();
+  return result;
+}
+
+/*
+ * call-seq:
+ *   script.bind(cxt)  => cxt
+ *
+ * Binds script to given context, so each run will be performed within it.
+ *
+ */
+static VALUE rb_v8_script_bind(VALUE self, VALUE cxt)
+{
+  return rb_iv_set(self, "@context", cxt);
+}
+
+/* Public constructors */
+
+VALUE rb_v8_script_new2(VALUE source, VALUE filename)
+{
+  VALUE args[2] = { source, filename };
+  return rb_v8_script_new(2, args, rb_cV8Script);
+}
+
+VALUE rb_v8_script_new3(VALUE source, VALUE filename, VALUE data)
+{
+  VALUE args[3] = { source, filename, data };
+  return rb_v8_script_new(3, args, rb_cV8Script);
+}
+
+VALUE rb_v8_script_precompile(VALUE source)
+{
+  StringValue(source);
+  ScriptData *pre_data = ScriptData::PreCompile(RSTRING_PTR(source), RSTRING_LEN(source));
+  VALUE data = Qnil;
+
+  if (!pre_data->HasError()) {
+    data = rb_str_new(pre_data->Data(), pre_data->Length());
+  }
+
+  delete pre_data;
+  return data;
+}
+
+
+/* V8::Script initializer. */
+void Init_V8_Script()
+{
+  rb_cV8Script = rb_define_class_under(rb_mV8, "Script", rb_cV8Data);
+  rb_define_singleton_method(rb_cV8Script, "new", RUBY_METHOD_FUNC(rb_v8_script_new), -1);
+  rb_define_singleton_method(rb_cV8Script, "precompile", RUBY_METHOD_FUNC(rb_v8_script_precompile_m), 1);
+  rb_define_method(rb_cV8Script, "run", RUBY_METHOD_FUNC(rb_v8_script_run), -1);
+  rb_define_method(rb_cV8Script, "bind", RUBY_METHOD_FUNC(rb_v8_script_bind), 1);
+  rb_define_attr(rb_cV8Script, "context", 1, 0);
+  rb_define_attr(rb_cV8Script, "filename", 1, 0);
+  rb_define_attr(rb_cV8Script, "data", 1, 0);
+}
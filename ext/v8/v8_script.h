@@ -0,0 +1,20 @@
+#ifndef __V8_SCRIPT_H
+#define __V8_SCRIPT_H
+
+#include "v8_main.h"
+
+using namespace v8;
+
+/* V8::Script class */
+RUBY_EXTERN VALUE rb_cV8Script;
+
+/* API */
+VALUE rb_v8_script_new2(VALUE source, VALUE filename);
+VALUE rb_v8_script_new3(VALUE source, VALUE filename, VALUE data);
+VALUE rb_v8_script_precompile(VALUE source);
+void v8_execute(void *(*func)(void*), void *data, double timeout=0);
+int v8_execution_depth();
+Local<Value> v8_script_run(Handle<Script> script, double timeout=0);
+void Init_V8_Script();
+
+#endif//__V8_SCRIPT_H
@@ -4,16 +4,187 @@
 #include "v8_string.h"
 #include "v8_macros.h"
 
+#ifdef HAVE_RUBY_ENCODING_H
+#include <ruby/encoding.h>
+#endif
+
 using namespace v8;
 
 VALUE rb_cV8String;
 UNWRAPPER(String);
 
+/* Local helpers */
+
+/*
+ * External string backed by frozen ruby string, so its contents are shared
+ * with V8 without copying. Ruby string is retained as long as V8 needs it.
+ *
+ */
+class v8_external_string : public String::ExternalAsciiStringResource {
+public:
+  v8_external_string(VALUE str)
+    : ptr(RSTRING_PTR(str)), len(RSTRING_LEN(str)), ref(v8_retain(str))
+  {
+  }
+
+  ~v8_external_string()
+  {
+    v8_release(ref);
+  }
+
+  const char *data() const { return ptr; }
+  size_t length() const { return len; }
+
+private:
+  const char *ptr;
+  size_t len;
+  rb_sV8Retained *ref;
+};
+
+/* Returns true when given string contains only 7-bit ASCII characters. */
+static bool v8_string_ascii_p(VALUE str)
+{
+#ifdef HAVE_RUBY_ENCODING_H
+  return rb_enc_str_coderange(str) == ENC_CODERANGE_7BIT;
+#else
+  const unsigned char *ptr = (const unsigned char*)RSTRING_PTR(str);
+
+  for (long i = 0; i < RSTRING_LEN(str); i++) {
+    if (ptr[i] > 127) {
+      return false;
+    }
+  }
+
+  return true;
+#endif
+}
+
+/*
+ * Converts given UTF-16 buffer into new ruby UTF-8 string. Surrogate pairs
+ * are joined, lone surrogates are encoded the same way as V8 does.
+ *
+ */
+static VALUE v8_utf16_to_utf8(const uint16_t *buf, int len)
+{
+  VALUE str = rb_str_buf_new(len * 3);
+  unsigned char *out = (unsigned char*)RSTRING_PTR(str);
+  long pos = 0;
+
+  for (int i = 0; i < len; i++) {
+    uint32_t c = buf[i];
+
+    if (c >= 0xD800 && c <= 0xDBFF && i + 1 < len && buf[i+1] >= 0xDC00 && buf[i+1] <= 0xDFFF) {
+      c = 0x10000 + ((c - 0xD800) << 10) + (buf[++i] - 0xDC00);
+    }
+
+    if (c < 0x80) {
+      out[pos++] = c;
+    } else if (c < 0x800) {
+      out[pos++] = 0xC0 | (c >> 6);
+      out[pos++] = 0x80 | (c & 0x3F);
+    } else if (c < 0x10000) {
+      out[pos++] = 0xE0 | (c >> 12);
+      out[pos++] = 0x80 | ((c >> 6) & 0x3F);
+      out[pos++] = 0x80 | (c & 0x3F);
+    } else {
+      out[pos++] = 0xF0 | (c >> 18);
+      out[pos++] = 0x80 | ((c >> 12) & 0x3F);
+      out[pos++] = 0x80 | ((c >> 6) & 0x3F);
+      out[pos++] = 0x80 | (c & 0x3F);
+    }
+  }
+
+  rb_str_set_len(str, pos);
+  return v8_set_utf8_encoding(str);
+}
+
 /* Typecasting helpers */
 
+/*
+ * Tags given ruby string as UTF-8 encoded one, when encodings are supported.
+ *
+ */
+VALUE v8_set_utf8_encoding(VALUE str)
+{
+#ifdef HAVE_RUBY_ENCODING_H
+  rb_enc_associate(str, rb_utf8_encoding());
+#endif
+  return str;
+}
+
+/* Single call of chunk function, performed under rb_protect. */
+struct v8_string_chunk_call {
+  VALUE (*fn)(VALUE chunk, VALUE arg);
+  VALUE chunk;
+  VALUE arg;
+};
+
+static VALUE v8_string_chunk_protected(VALUE data)
+{
+  v8_string_chunk_call *call = (v8_string_chunk_call*)data;
+  return call->fn(call->chunk, call->arg);
+}
+
+/*
+ * Passes UTF-8 contents of given V8 string to specified function, in chunks
+ * of at most given number of characters. Surrogate pairs are never split
+ * between chunks.
+ *
+ * Function can raise or break, so iteration stops then and state of the
+ * jump is returned. Caller has to pass it to <code>rb_jump_tag</code> once
+ * all its handle scopes are closed.
+ *
+ */
+int v8_string_each_chunk(Handle<String> value, int size, VALUE (*fn)(VALUE chunk, VALUE arg), VALUE arg)
+{
+  int len = value->Length();
+  int state = 0;
+  VALUE buffer = rb_str_buf_new(size * sizeof(uint16_t));
+  uint16_t *buf = (uint16_t*)RSTRING_PTR(buffer);
+  v8_string_chunk_call call;
+  call.fn = fn;
+  call.arg = arg;
+
+  for (int start = 0; start < len && state == 0; ) {
+    int count = value->Write(buf, start, size, String::HINT_MANY_WRITES_EXPECTED);
+
+    if (count > 1 && start + count < len && buf[count-1] >= 0xD800 && buf[count-1] <= 0xDBFF) {
+      count--;
+    }
+
+    call.chunk = v8_utf16_to_utf8(buf, count);
+    rb_protect(v8_string_chunk_protected, (VALUE)&call, &state);
+    start += count;
+  }
+
+  RB_GC_GUARD(buffer);
+  return state;
+}
+
+/*
+ * Returns UTF-8 contents of given V8 string. Ruby string is allocated once,
+ * with exact size, and V8 writes directly into it.
+ *
+ */
+VALUE v8_string_to_utf8(Handle<String> value)
+{
+  int len = value->Utf8Length();
+  VALUE str = rb_str_new(NULL, len);
+  value->WriteUtf8(RSTRING_PTR(str), len);
+  return v8_set_utf8_encoding(str);
+}
+
 Handle<Value> to_v8_string(VALUE value)
 {
-  return String::New(StringValuePtr(value));
+  StringValue(value);
+
+  // V8 can use external strings only when they're pure ASCII. Small ones
+  // are cheaper to copy anyway...
+  if (RSTRING_LEN(value) >= V8_EXTERNAL_STRING_MIN_LENGTH && v8_string_ascii_p(value)) {
+    return String::NewExternal(new v8_external_string(rb_str_new_frozen(value)));
+  }
+
+  return String::New(RSTRING_PTR(value), RSTRING_LEN(value));
 }
 
 /* V8::String methods */
@@ -44,7 +215,7 @@ static VALUE rb_v8_string_new(VALUE klass, VALUE data)
 static VALUE rb_v8_string_to_utf8(VALUE self)
 {
   HandleScope scope;
-  return rb_str_new2(*String::Utf8Value(unwrap(self)));
+  return v8_string_to_utf8(unwrap(self));
 }
 
 /*
@@ -57,7 +228,60 @@ static VALUE rb_v8_string_to_utf8(VALUE self)
 static VALUE rb_v8_string_to_ascii(VALUE self)
 {
   HandleScope scope;
-  return rb_str_new2(*String::AsciiValue(unwrap(self)));
+  Local<String> value = unwrap(self);
+  int len = value->Length();
+  VALUE str = rb_str_new(NULL, len);
+  value->WriteAscii(RSTRING_PTR(str), 0, len);
+  return str;
+}
+
+static VALUE v8_string_yield_chunk(VALUE chunk, VALUE arg)
+{
+  return rb_yield(chunk);
+}
+
+/*
+ * call-seq:
+ *   str.each_chunk(size=65536) { |chunk| ... }  => str
+ *   str.each_chunk(size=65536)                  => enumerator
+ *
+ * Yields UTF-8 contents of referenced string in chunks of at most given
+ * number of characters, so huge strings can be written out without building
+ * their full copy in memory. Surrogate pairs are never split between chunks.
+ *
+ *   File.open("dump.html", "w") { |f| str.each_chunk { |chunk| f.write(chunk) } }
+ *
+ */
+static VALUE rb_v8_string_each_chunk(int argc, VALUE *argv, VALUE self)
+{
+  RETURN_ENUMERATOR(self, argc, argv);
+
+  if (argc > 1) {
+    rb_raise(rb_eArgError, "wrong number of arguments (%d for 0..1)", argc);
+    return Qnil;
+  }
+
+  int size = argc == 1 ? NUM2INT(argv[0]) : V8_STRING_CHUNK_SIZE;
+
+  if (size <= 0) {
+    rb_raise(rb_eArgError, "chunk size must be positive");
+    return Qnil;
+  }
+
+  int state = 0;
+
+  {
+    HandleScope scope;
+    state = v8_string_each_chunk(unwrap(self), size, v8_string_yield_chunk, Qnil);
+  }
+
+  // Block can break or raise, so it's rethrown after handle scope has
+  // been closed...
+  if (state != 0) {
+    rb_jump_tag(state);
+  }
+
+  return self;
 }
 
 /* Public constructors */
@@ -76,4 +300,5 @@ void Init_V8_String()
   rb_define_method(rb_cV8String, "to_ascii", RUBY_METHOD_FUNC(rb_v8_string_to_ascii), 0);
   rb_define_method(rb_cV8String, "to_utf8", RUBY_METHOD_FUNC(rb_v8_string_to_utf8), 0);
   rb_define_method(rb_cV8String, "to_s", RUBY_METHOD_FUNC(rb_v8_string_to_utf8), 0);
+  rb_define_method(rb_cV8String, "each_chunk", RUBY_METHOD_FUNC(rb_v8_string_each_chunk), -1);
 }
@@ -5,11 +5,20 @@
 
 using namespace v8;
 
+/* Minimal length of ruby string shared with V8 instead of being copied. */
+#define V8_EXTERNAL_STRING_MIN_LENGTH 1024
+
+/* Default number of characters yielded by V8::String#each_chunk. */
+#define V8_STRING_CHUNK_SIZE 65536
+
 /* V8::String class */
 RUBY_EXTERN VALUE rb_cV8String;
 
 /* API */
 Handle<Value> to_v8_string(VALUE value);
+VALUE v8_string_to_utf8(Handle<String> value);
+int v8_string_each_chunk(Handle<String> value, int size, VALUE (*fn)(VALUE chunk, VALUE arg), VALUE arg);
+VALUE v8_set_utf8_encoding(VALUE str);
 VALUE rb_v8_string_new2(VALUE data);
 void Init_V8_String();
 
@@ -7,18 +7,22 @@ require 'mustang/v8/string'
 require 'mustang/v8/integer'
 require 'mustang/v8/number'
 require 'mustang/v8/array'
+require 'mustang/v8/buffer'
 require 'mustang/v8/date'
 require 'mustang/v8/regexp'
 require 'mustang/v8/function'
 require 'mustang/v8/external'
 require 'mustang/v8/boolean'
 require 'mustang/v8/error'
+require 'mustang/v8/profiler'
 
 require 'mustang/core_ext/object'
 require 'mustang/core_ext/class'
 require 'mustang/core_ext/symbol'
 
+require 'mustang/script_cache'
 require 'mustang/context'
+require 'mustang/context_pool'
 
 module Mustang
   extend Delegated
@@ -31,8 +35,45 @@ module Mustang
     @global or reset!
   end
 
-  # Resets global context state (just creates new global context and enters to it). 
+  # Returns cache of scripts' preparse data used by <tt>Context#load</tt>, or
+  # <tt>nil</tt> when caching is disabled. By default it's enabled when the
+  # <tt>MUSTANG_CACHE_DIR</tt> environment variable is set.
+  def self.script_cache
+    if !defined?(@script_cache) && ENV['MUSTANG_CACHE_DIR']
+      @script_cache = ScriptCache.new(ENV['MUSTANG_CACHE_DIR'])
+    end
+    @script_cache
+  end
+
+  # Enables persistent preparse cache stored in given directory. Passing
+  # <tt>nil</tt> disables caching.
+  def self.cache_dir=(dir)
+    @script_cache = dir && ScriptCache.new(dir)
+  end
+
+  # Returns pool of contexts used by <tt>reset!</tt>, if any.
+  def self.pool
+    @pool
+  end
+
+  # Sets pool of pre-warmed contexts, eg:
+  #
+  #   Mustang.pool = Mustang::ContextPool.new(2, :globals => {:foo => 1})
+  #
+  def self.pool=(pool)
+    @pool = pool
+  end
+
+  # Resets global context state (just creates new global context and enters to it).
+  # When pool of contexts is set then current global context is given back to it
+  # and warm one is taken instead. Returned contexts are warmed up again with
+  # <tt>Mustang.pool.refill</tt>, eg. after each scenario.
   def self.reset!(*args, &block)
-    @global = Context.new(*args, &block)
+    if pool && args.empty? && !block
+      pool.checkin(@global) if @global
+      @global = pool.checkout
+    else
+      @global = Context.new(*args, &block)
+    end
   end
 end # Mustang
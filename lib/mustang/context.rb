@@ -23,9 +23,14 @@ module Mustang
     #   rt.evaluate("bar=foo+spam", :spam => 10) # => 11
     #   rt.evaliate("bar")                       # => 11
     #
-    def evaluate(source, locals={}, filename="<eval>")
+    # When timeout (in seconds) is given then evaluation is terminated after
+    # that time, and <tt>Mustang::V8::TimeoutError</tt> is returned, eg:
+    #
+    #   rt.evaluate("while(true){}", {}, "<eval>", 0.5) # => #<TimeoutError>
+    #
+    def evaluate(source, locals={}, filename="<eval>", timeout=nil)
       set_all(locals)
-      super(source, filename)
+      super(source, filename, timeout)
     end
     alias_method :eval, :evaluate
 
@@ -34,16 +39,46 @@ module Mustang
     #   rt = Mustang::Runtime.new
     #   rt.load("foo.js", "bar.js")
     #
+    # When script cache is enabled (see <tt>Mustang.cache_dir=</tt>) then
+    # preparse data of loaded files is read from it instead of parsing them
+    # again in each process.
+    #
     def load(*files)
       files.map { |filename|
         if File.exists?(filename)
-          evaluate(File.read(filename), {}, filename)
+          if cache = Mustang.script_cache
+            source = File.read(filename)
+            script = compile(source, filename, cache.fetch(source))
+            script.error? ? script : script.run
+          else
+            evaluate(File.read(filename), {}, filename)
+          end
         else
           raise ScriptNotFoundError, "script file `#{filename}' does not exist."
         end
       }.last
     end
 
+    # Compiles given javascript source and binds it to current context. Compiled
+    # script can be run many times without parsing its source again, eg:
+    #
+    #   rt = Mustang::Context.new
+    #   script = rt.compile("foo+1", "foo.js")
+    #   rt[:foo] = 1
+    #   script.run # => 2
+    #   rt[:foo] = 2
+    #   script.run # => 3
+    #
+    # Preparse data (eg. read from <tt>Mustang::ScriptCache</tt>) can be
+    # passed as well.
+    #
+    def compile(source, filename="<eval>", data=nil)
+      enter
+      script = V8::Script.new(source, filename, data)
+      script.bind(self) unless script.error?
+      script
+    end
+
     # Stores all given values to global prototype.
     def set_all(values={})
       values.each { |key, val| set(key, val) }
@@ -0,0 +1,110 @@
+module Mustang
+  # Pool of pre-warmed contexts. Each context in the pool has set given
+  # globals and ran given library scripts, so handing it out costs almost
+  # nothing. Scripts are compiled only once and shared between all pooled
+  # contexts, eg:
+  #
+  #   pool = Mustang::ContextPool.new(2, :globals => {:foo => 1}, :scripts => ["jquery.js"])
+  #   pool.with { |cxt| cxt.eval("foo") } # => 1
+  #
+  # Returned contexts are not touched on checkin, they're only queued for
+  # reuse. Call <tt>refill</tt> in idle gaps (eg. between requests or test
+  # scenarios) to reset (see <tt>V8::Context#reset!</tt>) and warm them up
+  # again off the hot path. When no warm context is left, checkout warms up
+  # returned one by itself.
+  #
+  # Each refill is treated as an idle gap, and V8 is notified about it
+  # (see <tt>V8.idle_notification</tt>), so garbage left by previous users
+  # is reclaimed. Pass <tt>:idle_notification => false</tt> to disable it.
+  #
+  class ContextPool
+    attr_reader :size, :globals, :scripts
+
+    def initialize(size=1, options={})
+      @size = size
+      @globals = options[:globals] || {}
+      @scripts = Array(options[:scripts])
+      @idle_notification = options.fetch(:idle_notification, true)
+      @available = []
+      @returned = []
+      size.times { @available << warm(Context.new) }
+    end
+
+    # Returns number of warm contexts ready to hand out.
+    def available
+      @available.size
+    end
+
+    # Returns number of returned contexts waiting for refill.
+    def returned
+      @returned.size
+    end
+
+    # Takes warm context from the pool and enters it. When there is no
+    # warm context then returned one is reset and warmed up, or new one
+    # is created if pool is empty.
+    def checkout
+      cxt = @available.pop || rewarm(@returned.shift) || warm(Context.new)
+      cxt.enter
+      cxt
+    end
+
+    # Gives given context back to the pool. Context is only queued here,
+    # it's reset and warmed up again by <tt>refill</tt> or next checkout.
+    def checkin(cxt)
+      cxt.exit
+      @returned.push(cxt) if @available.size + @returned.size < size
+      nil
+    end
+
+    # Resets and warms up all returned contexts, so next checkouts hand out
+    # ready ones. Meant to be called when there is nothing else to do.
+    def refill
+      @available.push(rewarm(@returned.shift)) until @returned.empty?
+      V8.idle_notification if @idle_notification
+      available
+    end
+
+    # Checks out context for block execution.
+    def with
+      cxt = checkout
+      yield cxt
+    ensure
+      checkin(cxt) if cxt
+    end
+
+    private
+
+    def compiled_scripts(cxt) # :nodoc:
+      @compiled ||= scripts.map { |filename|
+        if File.exist?(filename)
+          source = File.read(filename)
+          data = Mustang.script_cache.fetch(source) if Mustang.script_cache
+          script = cxt.compile(source, filename, data)
+          raise script.message if script.error?
+          script
+        else
+          raise ScriptNotFoundError, "script file `#{filename}' does not exist."
+        end
+      }
+    end
+
+    def rewarm(cxt) # :nodoc:
+      if cxt
+        cxt.reset!
+        warm(cxt)
+      end
+    end
+
+    # Scripts are run within warmed context, which is entered only for that
+    # time, so context entered by the caller stays current.
+    def warm(cxt) # :nodoc:
+      entered = cxt.enter
+      cxt.set_all(globals)
+      compiled_scripts(cxt).each { |script| script.run(cxt) }
+      cxt
+    ensure
+      cxt.exit if entered
+    end
+  end # ContextPool
+end # Mustang
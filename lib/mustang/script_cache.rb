@@ -0,0 +1,61 @@
+require 'digest/sha1'
+require 'fileutils'
+
+module Mustang
+  # Persistent on-disk cache of scripts' preparse data. Entries are keyed by
+  # hash of script source (and V8 version, because preparse data is platform
+  # dependent), so each process loading the same libraries can skip parsing
+  # them from scratch, eg:
+  #
+  #   cache = Mustang::ScriptCache.new("tmp/mustang")
+  #   data = cache.fetch(File.read("jquery.js"))
+  #   script = Mustang::V8::Script.new(File.read("jquery.js"), "jquery.js", data)
+  #
+  class ScriptCache
+    attr_reader :dir
+
+    def initialize(dir)
+      @dir = File.expand_path(dir)
+      FileUtils.mkdir_p(@dir)
+    end
+
+    # Returns cache key for given source.
+    def key(source)
+      Digest::SHA1.hexdigest("#{V8.version}:#{source}")
+    end
+
+    # Returns path to cache entry of given source.
+    def path(source)
+      File.join(dir, "#{key(source)}.preparse")
+    end
+
+    # Returns cached preparse data of given source. When there is no such
+    # entry yet then source is precompiled and stored in cache.
+    def fetch(source)
+      read(source) or write(source, V8::Script.precompile(source))
+    end
+
+    # Returns cached preparse data of given source or nil when not cached.
+    def read(source)
+      file = path(source)
+      File.open(file, 'rb') { |f| f.read } if File.exist?(file)
+    end
+
+    # Stores given preparse data in cache. Data is written to temporary file
+    # first and moved to target, so concurrent workers never see partial
+    # entries.
+    def write(source, data)
+      return data if data.nil?
+      file = path(source)
+      tmp = "#{file}.#{Process.pid}.tmp"
+      File.open(tmp, 'wb') { |f| f.write(data) }
+      File.rename(tmp, file)
+      data
+    end
+
+    # Removes all cached entries.
+    def clear!
+      Dir[File.join(dir, "*.preparse")].each { |file| File.delete(file) }
+    end
+  end # ScriptCache
+end # Mustang
@@ -8,10 +8,6 @@ module Mustang
         to_a <=> other
       end
       
-      def each(*args, &block)
-        to_a.each(*args, &block)
-      end
-      
       def delegate
         to_a
       end
@@ -0,0 +1,31 @@
+module Mustang
+  module V8
+    class Buffer
+      include Enumerable
+      include Delegated
+
+      # Directives used to unpack buffer's data, by element type.
+      UNPACK_DIRECTIVES = {
+        :int8   => 'c*',
+        :uint8  => 'C*',
+        :int16  => 's*',
+        :uint16 => 'S*',
+        :int32  => 'l*',
+        :uint32 => 'L*',
+        :float  => 'f*',
+      }
+
+      def to_a
+        to_s.unpack(UNPACK_DIRECTIVES[type])
+      end
+
+      def each(*args, &block)
+        to_a.each(*args, &block)
+      end
+
+      def delegate
+        to_a
+      end
+    end # Buffer
+  end # V8
+end # Mustang
@@ -1,16 +1,22 @@
 module Mustang
   module V8
     class Error
+      # Message can't be reflected outside of error's isolate, unless it
+      # was read before, so only error name is shown then.
       def inspect
         "#{name}: #{message}"
+      rescue RuntimeError
+        name
       end
       
       def to_s
         message
+      rescue RuntimeError
+        name
       end
       
       def name
-        self.class.name.delete("Mustang::V8::")
+        self.class.name.sub("Mustang::V8::", "")
       end
     end # Error
   end # V8
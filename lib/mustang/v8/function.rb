@@ -4,6 +4,21 @@ module Mustang
       def call(*args, &block)
         call_on(@receiver || nil, *args, &block);
       end
+
+      # Streaming version of <tt>#call_many</tt>, which takes any enumerable
+      # (eg. lazily produced) sequence of argument tuples, calls function in
+      # batches of given size, and yields results one by one, eg:
+      #
+      #   func.call_each(nil, rows.each) { |html| out.write(html) }
+      #
+      # Returns enumerator when no block given.
+      def call_each(recv, tuples, batch_size=256)
+        return enum_for(:call_each, recv, tuples, batch_size) unless block_given?
+        tuples.each_slice(batch_size) { |batch|
+          call_many(recv, batch).each { |result| yield result }
+        }
+        self
+      end
     end # Function
   end # V8
 end # Mustang
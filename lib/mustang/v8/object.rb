@@ -1,17 +1,6 @@
 module Mustang
   module V8
     class Object
-      # We have to extend native <tt>.new</tt> method with full support for reflection
-      # of ruby objects. 
-      class << self
-        alias_method :native_new, :new
-
-        def new(*args, &block)
-          res = native_new(*args)
-          res.send(:reflect_from, args.first)        
-        end
-      end
-      
       def respond_to?(meth) # :nodoc:
         if array?
           super
@@ -21,8 +10,9 @@ module Mustang
       end
 
       def method_missing(meth, *args, &block) # :nodoc:
-        if respond_to?(meth)
-          property = self[meth]
+        # Property is fetched only once here, instead of checking it
+        # with #respond_to? first...
+        unless array? or (property = get(meth.to_s)).undefined?
           if property.is_a?(Function)
             return property.call_on(self, *args, &block)
           else
@@ -36,17 +26,15 @@ module Mustang
       include Delegated
 
       def to_hash
-        Hash[*keys.map {|key| [key.to_s, get(key)] }.flatten(1)]
+        hash = {}
+        each_pair { |key, value| hash[key] = value }
+        hash
       end
 
       def <=>(other)
         to_hash <=> other
       end
 
-      def each(*args, &block)
-        to_hash.each(*args, &block)
-      end
-
       def delegate
         to_hash
       end
@@ -54,20 +42,6 @@ module Mustang
       def ==(other)
         super(other) or to_hash == other
       end
-
-      private
-      
-      def reflect_from(obj) # :nodoc:
-        if !obj.nil? and !obj.v8? and !obj.is_a?(Hash)
-          obj.class.declared_methods.each { |meth|
-            if func_name = meth.to_sym.to_js_func_name
-              func = set(func_name, obj.method(meth))
-              func.bind(obj)
-            end
-          }
-        end
-        self
-      end
     end # Object
   end # V8
 end # Mustang
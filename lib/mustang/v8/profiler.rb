@@ -0,0 +1,104 @@
+module Mustang
+  module V8
+    module Profiler
+      # Single function in profile's call tree. Times are in milliseconds.
+      class Node < Struct.new(:function_name, :script_name, :line_no, :self_ticks,
+                              :total_ticks, :self_time, :total_time, :children)
+        def self.from_hash(hash) # :nodoc:
+          new(*members.map { |key|
+            key.to_sym == :children ? hash[:children].map { |child| from_hash(child) } : hash[key.to_sym]
+          })
+        end
+
+        # Returns human readable location of the function, eg:
+        #
+        #   node.label # => "render (app.js:12)"
+        #
+        def label
+          name = function_name.to_s.empty? ? "(anonymous)" : function_name
+          script_name.to_s.empty? ? name : "#{name} (#{script_name}:#{line_no})"
+        end
+      end # Node
+
+      # Collected CPU profile, which can be browsed as call tree, viewed as
+      # flat list of the hottest functions, or exported for flame graphs.
+      class Profile
+        attr_reader :root
+
+        def initialize(tree)
+          @root = Node.from_hash(tree)
+        end
+
+        # Returns total number of samples collected.
+        def ticks
+          root.total_ticks
+        end
+
+        # Yields each node of the call tree, together with its call stack
+        # (list of callers' nodes, starting from the outermost one).
+        def each_node(node=root, stack=[], &block)
+          node.children.each { |child|
+            yield(child, stack)
+            each_node(child, stack + [child], &block)
+          }
+        end
+
+        # Returns flat list of functions with the highest self ticks. Ticks
+        # and times of the same function called from different places are
+        # summed up, eg:
+        #
+        #   profile.top(3).map { |node| [node.label, node.self_ticks] }
+        #   # => [["parse (app.js:10)", 120], ["render (app.js:42)", 80], ...]
+        #
+        def top(n=10)
+          flat = {}
+          each_node { |node, stack|
+            key = [node.function_name, node.script_name, node.line_no]
+            entry = flat[key] ||= Node.new(*key + [0, 0, 0.0, 0.0, []])
+            entry.self_ticks += node.self_ticks
+            entry.self_time += node.self_time
+            # Recursive calls would count total time many times...
+            unless stack.any? { |caller| [caller.function_name, caller.script_name, caller.line_no] == key }
+              entry.total_ticks += node.total_ticks
+              entry.total_time += node.total_time
+            end
+          }
+          flat.values.sort_by { |node| -node.self_ticks }.first(n)
+        end
+
+        # Returns profile in collapsed stacks format, understood by flame graph
+        # tools (eg. flamegraph.pl), with one call stack and number of its self
+        # ticks per line, eg:
+        #
+        #   main (app.js:1);render (app.js:42);parse (app.js:10) 120
+        #
+        def to_collapsed
+          lines = []
+          each_node { |node, stack|
+            if node.self_ticks > 0
+              lines << "#{(stack + [node]).map { |n| n.label.tr(';', ',') }.join(';')} #{node.self_ticks}"
+            end
+          }
+          lines.join("\n")
+        end
+      end # Profile
+
+      # Collects CPU profile of javascript executed within given block, eg:
+      #
+      #   profile = Mustang::V8::Profiler.profile { cxt.eval("heavy()", "<eval>") }
+      #   profile.top(10)
+      #   File.write("app.folded", profile.to_collapsed)
+      #
+      def self.profile(title=nil)
+        title ||= "mustang-profile-#{Thread.current.object_id}-#{Time.now.to_f}"
+        start(title)
+        begin
+          yield
+        ensure
+          tree = stop(title)
+        end
+        Profile.new(tree)
+      end
+    end # Profiler
+  end # V8
+end # Mustang
@@ -0,0 +1,92 @@
+require File.dirname(__FILE__) + '/../spec_helper'
+
+describe Mustang::ContextPool do
+  let(:fixture) { File.expand_path("../../fixtures/test1.js", __FILE__) }
+  subject { Mustang::ContextPool.new(2, :globals => {:spam => 'eggs'}, :scripts => [fixture]) }
+
+  describe ".new" do
+    it "pre-warms given number of contexts" do
+      subject.available.should == 2
+    end
+
+    it "leaves current context unchanged" do
+      outer = Mustang::Context.new
+      outer.enter
+      subject
+      Mustang::V8::Context.current.should == outer
+      outer.exit
+    end
+  end
+
+  describe "#checkout" do
+    it "returns entered context with set globals and loaded scripts" do
+      cxt = subject.checkout
+      cxt.should be_kind_of(Mustang::Context)
+      cxt.should be_entered
+      cxt[:spam].should == 'eggs'
+      cxt[:foo].should == 'test1foo'
+      subject.available.should == 1
+    end
+
+    context "when pool is empty" do
+      it "creates new warm context" do
+        3.times.map { subject.checkout }.last[:spam].should == 'eggs'
+        subject.available.should == 0
+      end
+    end
+  end
+
+  describe "#checkin" do
+    it "puts given context back into pool without resetting it" do
+      cxt = subject.checkout
+      subject.checkin(cxt)
+      cxt.should_not be_entered
+      subject.available.should == 1
+      subject.returned.should == 1
+    end
+
+    context "when no warm context left" do
+      it "resets returned context on checkout" do
+        cxts = 2.times.map { subject.checkout }
+        cxts.last.eval("var bar = 1; spam = 'changed';")
+        subject.checkin(cxts.last)
+        cxt = subject.checkout
+        cxt.should == cxts.last
+        cxt.eval("typeof bar").should == 'undefined'
+        cxt[:spam].should == 'eggs'
+        subject.returned.should == 0
+      end
+    end
+  end
+
+  describe "#refill" do
+    it "resets and warms up returned contexts" do
+      cxt = subject.checkout
+      cxt.eval("var bar = 1; spam = 'changed';")
+      subject.checkin(cxt)
+      subject.refill.should == 2
+      subject.returned.should == 0
+      2.times.map { subject.checkout }.each do |cxt|
+        cxt.eval("typeof bar").should == 'undefined'
+        cxt[:spam].should == 'eggs'
+      end
+    end
+
+    it "leaves current context unchanged" do
+      subject.checkin(subject.checkout)
+      outer = Mustang::Context.new
+      outer.enter
+      subject.refill
+      Mustang::V8::Context.current.should == outer
+      outer.exit
+    end
+  end
+
+  describe "#with" do
+    it "checks out context for block execution" do
+      subject.with { |cxt| cxt.eval("spam + foo") }.should == 'eggstest1foo'
+      subject.available.should == 1
+      subject.returned.should == 1
+    end
+  end
+end
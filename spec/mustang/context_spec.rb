@@ -1,4 +1,5 @@
 require File.dirname(__FILE__) + '/../spec_helper'
+require 'tmpdir'
 
 describe Mustang::Context do
   it "inherits Mustang::V8::Context" do
@@ -29,6 +30,40 @@ describe Mustang::Context do
     end
   end
 
+  describe "#compile" do
+    it "returns script bound to current context" do
+      script = subject.compile("foo+1", "foo.js")
+      script.should be_kind_of(Mustang::V8::Script)
+      script.context.should == subject
+      subject[:foo] = 1
+      script.run.should == 2
+      subject[:foo] = 2
+      script.run.should == 3
+    end
+
+    context "when source is broken" do
+      it "returns proper error" do
+        subject.compile("broken {[/").should be_syntax_error
+      end
+    end
+  end
+
+  describe ".reset!" do
+    after { Mustang.pool = nil }
+
+    context "when pool is set" do
+      it "takes warm context from it" do
+        Mustang.pool = Mustang::ContextPool.new(1, :globals => {:foo => 1})
+        Mustang.reset!
+        Mustang.global[:foo].should == 1
+        Mustang.pool.available.should == 0
+        Mustang.reset!
+        Mustang.pool.available.should == 0
+        Mustang.global[:foo].should == 1
+      end
+    end
+  end
+
   describe "#load" do
     context "when existing files specified" do
       it "loads and executes given files" do
@@ -39,6 +74,18 @@ describe Mustang::Context do
       end
     end
 
+    context "when script cache enabled" do
+      before { Mustang.cache_dir = File.join(Dir.tmpdir, "mustang-cache-#{Process.pid}") }
+      after { Mustang.script_cache.clear!; Mustang.cache_dir = nil }
+
+      it "loads files using cached preparse data" do
+        file = File.expand_path("../../fixtures/test1.js", __FILE__)
+        subject.load(file).should == 'test1foo'
+        Mustang.script_cache.read(File.read(file)).should be
+        subject.load(file).should == 'test1foo'
+      end
+    end
+
     context "when file not found" do
       it "raises ScriptNotFoundError" do
         expect { subject.load("notexists.js") }.to raise_error(Errno::ENOENT, "No such file or directory - script file `notexists.js' does not exist.")
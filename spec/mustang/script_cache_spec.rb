@@ -0,0 +1,51 @@
+require File.dirname(__FILE__) + '/../spec_helper'
+require 'tmpdir'
+
+describe Mustang::ScriptCache do
+  let(:dir) { File.join(Dir.tmpdir, "mustang-cache-#{Process.pid}") }
+  let(:source) { File.read(File.expand_path("../../fixtures/test1.js", __FILE__)) }
+  subject { Mustang::ScriptCache.new(dir) }
+  after { FileUtils.rm_rf(dir) }
+
+  it "creates cache directory" do
+    subject
+    File.directory?(dir).should be_true
+  end
+
+  describe "#key" do
+    it "returns the same key for the same source" do
+      subject.key(source).should == subject.key(source.dup)
+    end
+
+    it "returns different keys for different sources" do
+      subject.key(source).should_not == subject.key("var a = 1;")
+    end
+  end
+
+  describe "#fetch" do
+    context "when source is not cached" do
+      it "precompiles it and stores preparse data in cache" do
+        subject.read(source).should_not be
+        data = subject.fetch(source)
+        data.should == Mustang::V8::Script.precompile(source)
+        File.exist?(subject.path(source)).should be_true
+      end
+    end
+
+    context "when source is cached" do
+      it "returns stored preparse data" do
+        data = subject.fetch(source)
+        Mustang::V8::Script.expects(:precompile).never
+        subject.fetch(source).should == data
+      end
+    end
+  end
+
+  describe "#clear!" do
+    it "removes all cached entries" do
+      subject.fetch(source)
+      subject.clear!
+      subject.read(source).should_not be
+    end
+  end
+end
@@ -52,6 +52,74 @@ describe Mustang::V8::Array do
     end
   end
 
+  describe "#[]" do
+    let(:ary) { subject.new(1,2,3,4) }
+
+    it "returns entry with given index" do
+      ary[1].should == 2
+    end
+
+    it "returns slice with given range" do
+      ary[1..2].should == [2,3]
+      ary[-2..-1].should == [3,4]
+      ary[5..6].should be_nil
+    end
+
+    it "returns slice with given start and length" do
+      ary[1,2].should == [2,3]
+      ary[3,10].should == [4]
+      ary[5,1].should be_nil
+    end
+  end
+
+  describe "#each" do
+    it "yields entries until block breaks" do
+      ary = subject.new(*(1..1000).to_a)
+      ary.first(2).should == [1,2]
+      ary.find { |x| x > 10 }.should == 11
+    end
+
+    it "returns enumerator when no block given" do
+      subject.new(1,2).each.to_a.should == [1,2]
+    end
+
+    it "can be broken out many times" do
+      ary = subject.new(*(1..100).to_a)
+      1000.times { ary.each { |x| break } }
+      ary.first.should == 1
+    end
+  end
+
+  describe "#each_with_index" do
+    it "yields entries together with their indexes" do
+      res = []
+      subject.new("a","b").each_with_index { |x, i| res << [x.to_s, i] }
+      res.should == [["a", 0], ["b", 1]]
+    end
+  end
+
+  describe "#include?" do
+    let(:ary) { subject.new(1, "foo", 2.5, nil) }
+
+    it "returns true when array contains given primitive value" do
+      ary.should include(1)
+      ary.should include("foo")
+      ary.should include(2.5)
+      ary.should include(nil)
+      ary.should_not include("bar")
+    end
+
+    it "compares reflected objects by identity" do
+      obj = Mustang::V8::Object.new
+      subject.new(obj).should include(obj)
+      subject.new(Mustang::V8::Object.new).should_not include(obj)
+    end
+
+    it "compares other ruby objects with converted entries" do
+      subject.new([1,2], [3]).should include([3])
+    end
+  end
+
   describe "#push" do
     it "appends given object to array" do
       ary = subject.new
@@ -0,0 +1,94 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe Mustang::V8::Buffer do
+  subject { Mustang::V8::Buffer }
+  setup_context
+
+  it "inherits Mustang::V8::Object" do
+    subject.new(4).should be_kind_of(Mustang::V8::Object)
+  end
+
+  describe ".new" do
+    context "when no context entered" do
+      it "should raise error" do
+        Mustang::V8::Context.exit_all!
+        expect { subject.new(4) }.to raise_error(RuntimeError, "can't create V8 object without entering into context")
+      end
+    end
+
+    context "when length given" do
+      it "creates zeroed buffer of given length" do
+        buf = subject.new(4)
+        buf.type.should == :uint8
+        buf.length.should == 4
+        buf.to_a.should == [0, 0, 0, 0]
+      end
+    end
+
+    context "when string given" do
+      it "creates buffer with copy of its contents" do
+        str = "\x01\x02\x03"
+        buf = subject.new(str)
+        buf.to_a.should == [1, 2, 3]
+        str.should == "\x01\x02\x03"
+      end
+    end
+
+    context "when type given" do
+      it "creates buffer with elements of that type" do
+        buf = subject.new(2, :int32)
+        buf.type.should == :int32
+        buf.length.should == 2
+        buf.bytesize.should == 8
+      end
+    end
+
+    context "when invalid params given" do
+      it "raises error" do
+        expect { subject.new(2, :foo) }.to raise_error(ArgumentError)
+        expect { subject.new(-1) }.to raise_error(ArgumentError)
+        expect { subject.new(2**31) }.to raise_error(ArgumentError)
+        expect { subject.new(2**29, :int32) }.to raise_error(ArgumentError)
+      end
+    end
+  end
+
+  describe "javascript access" do
+    it "reads and writes buffer's data in place" do
+      buf = subject.new("\x01\x02\x03")
+      cxt = Mustang::V8::Context.new
+      cxt[:buf] = buf
+      cxt.eval("buf[1] = buf[0] + buf[2]; buf.length", "<eval>").should == 3
+      buf.to_s.should == "\x01\x04\x03"
+    end
+
+    it "keeps values within element type" do
+      buf = subject.new(1, :int8)
+      cxt = Mustang::V8::Context.new
+      cxt[:buf] = buf
+      cxt.eval("buf[0] = 255", "<eval>")
+      buf.to_a.should == [-1]
+    end
+  end
+
+  describe "#to_s" do
+    it "returns copy of binary data" do
+      subject.new(2, :uint16).to_s.should == "\x00\x00\x00\x00"
+    end
+  end
+
+  describe "#to_a" do
+    it "returns array of buffer's elements" do
+      subject.new("\xff\xfe").to_a.should == [255, 254]
+    end
+  end
+
+  describe "casting" do
+    it "reflects buffers back as buffers" do
+      cxt = Mustang::V8::Context.new
+      cxt[:buf] = subject.new(4)
+      cxt[:buf].should be_kind_of(subject)
+      cxt[:buf].length.should == 4
+    end
+  end
+end
@@ -30,6 +30,13 @@ describe "Typecasting" do
       undefined.should be_undefined
     end
 
+    it "returns the same singletons for null, undefined and booleans" do
+      cxt.eval("null", "<eval>").should equal(Mustang::V8::Null)
+      cxt.eval("undefined", "<eval>").should equal(Mustang::V8::Undefined)
+      cxt.eval("true", "<eval>").should equal(Mustang::V8::True)
+      cxt.eval("false", "<eval>").should equal(Mustang::V8::False)
+    end
+
     it "converts boolean values properly" do
       cxt.eval("true", "<eval>").should == true
       cxt.eval("false", "<eval>").should == false
@@ -101,6 +108,15 @@ describe "Typecasting" do
       cxt.eval("foo[2] == 3", "<eval>").should be
     end
 
+    it "converts homogeneous arrays properly" do
+      cxt[:ints] = [1, 2**40, -3]
+      cxt[:floats] = [1.5, 2.5]
+      cxt[:strs] = ["foo", "b\0r"]
+      cxt.eval("ints[1] == #{2**40} && ints.length == 3", "<eval>").should be
+      cxt.eval("floats[0] + floats[1] == 4", "<eval>").should be
+      cxt.eval("strs[0] == 'foo' && strs[1].length == 3", "<eval>").should be
+    end
+
     it "converts procs and lambdas properly" do
       cxt[:foo] = proc {|foo| "foo#{foo}" }
       cxt[:bar] = lambda {|foo| "foo#{foo}" }
@@ -114,6 +130,12 @@ describe "Typecasting" do
       cxt.eval("foo.b == 2", "<eval>").should be
     end
 
+    it "converts nested hashes properly" do
+      cxt[:foo] = {"a" => {:b => [1, {:c => "d"}]}, 1 => nil}
+      cxt.eval("foo.a.b[1].c == 'd'", "<eval>").should be
+      cxt.eval("foo[1] === null", "<eval>").should be
+    end
+
     it "converts ranges properly" do
       cxt[:foo] = 1..2
       cxt.eval("foo[0] == 1", "<eval>").should be
@@ -132,6 +154,14 @@ describe "Typecasting" do
       cxt.eval("foo == #{Time.now.to_s}", "<eval>").should be
     end
 
+    it "keeps converted ruby objects alive while they're referenced from js" do
+      cxt[:foo] = proc { "bar" }
+      cxt[:obj] = Object.new
+      GC.start
+      cxt.eval("foo()", "<eval>").should == "bar"
+      cxt.eval("obj", "<eval>").should be_kind_of(Mustang::V8::Object)
+    end
+
     it "converts objects properly" do
       class Obj
         attr_accessor :bar
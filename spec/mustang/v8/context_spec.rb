@@ -22,6 +22,45 @@ describe Mustang::V8::Context do
     it "is aliased by #eval" do
       subject.eval("'foo'", "<eval>").should == 'foo'
     end
+
+    context "when timeout given" do
+      it "terminates execution which takes longer" do
+        result = subject.evaluate("while(true){}", "<eval>", 0.1)
+        result.should be_kind_of(Mustang::V8::TimeoutError)
+        result.should be_timeout_error
+      end
+
+      it "returns result of execution which finishes on time" do
+        subject.evaluate("1+1", "<eval>", 1).should == 2
+        subject.evaluate("2+2", "<eval>").should == 4
+      end
+
+      it "terminates outer execution when nested one times out" do
+        subject[:nested] = lambda { subject.evaluate("while(true){}", "<eval>", 0.1) }
+        subject.evaluate("nested(); 1", "<eval>").should be_timeout_error
+        subject.evaluate("1+1", "<eval>").should == 2
+      end
+    end
+  end
+
+  describe "#parse_json" do
+    it "returns parsed value" do
+      result = subject.parse_json('{"foo": [1, 2], "bar": "spam"}')
+      result.should be_kind_of(Mustang::V8::Object)
+      result[:foo].to_a.should == [1, 2]
+      result[:bar].should == "spam"
+    end
+
+    it "returns syntax error when invalid json given" do
+      result = subject.parse_json('{foo')
+      result.should be_error
+      result.should be_syntax_error
+    end
+
+    it "uses builtin parser even if JSON has been replaced" do
+      subject.eval("JSON = {parse: function() { return 'hijacked' }}", "<eval>")
+      subject.parse_json('[1]').to_a.should == [1]
+    end
   end
 
   describe "#[]" do
@@ -50,6 +89,21 @@ describe Mustang::V8::Context do
     end
   end
 
+  describe "#reset!" do
+    it "replaces context with fresh one" do
+      subject.evaluate("var foo = 'bar'", "<eval>")
+      subject.reset!.should == subject
+      subject.evaluate("typeof foo", "<eval>").should == 'undefined'
+    end
+
+    it "keeps the same global object" do
+      global = subject.global
+      subject.reset!
+      subject['foo'] = 'bar'
+      global['foo'].should == 'bar'
+    end
+  end
+
   describe "#global" do
     it "returns the global object for current context" do
       subject.global.should be_kind_of(Mustang::V8::Object)
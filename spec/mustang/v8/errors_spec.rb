@@ -77,6 +77,41 @@ describe Mustang::V8::Error do
         exc.end_col.should == 14
       end
     end
+
+    describe "#stack_trace" do
+      it "returns formatted stack trace of thrown error" do
+        exc = cxt.eval("function foo() { throw new Error('bar') }\nfoo()", "<eval>")
+        exc.stack_trace.should =~ /^Error: bar\n\s+at foo \(<eval>:1/
+      end
+    end
+  end
+
+  context "when read outside of its isolate" do
+    it "raises error unless details were read before" do
+      iso = Mustang::V8::Isolate.new
+      errors = iso.enter {
+        cxt = Mustang::V8::Context.new
+        [cxt.eval("broken$code", "<eval>"), cxt.eval("broken$code", "<eval>").tap { |e| e.message }]
+      }
+      expect { errors.first.message }.to raise_error(RuntimeError, "can't reflect error details outside of its isolate or V8 lock")
+      errors.last.message.should == "broken$code is not defined"
+    end
+
+    it "falls back to error name when inspected" do
+      iso = Mustang::V8::Isolate.new
+      err = iso.enter { Mustang::V8::Context.new.eval("broken$code", "<eval>") }
+      err.inspect.should == "ReferenceError"
+      err.to_s.should == "ReferenceError"
+    end
+  end
+
+  context "when thrown value is not an error object" do
+    it "uses its string representation as message" do
+      exc = cxt.eval("throw 'foo'", "<eval>")
+      exc.should be_error
+      exc.message.should == "foo"
+      exc.stack_trace.should be_nil
+    end
   end
 end
 
@@ -131,6 +166,16 @@ describe Mustang::V8::RangeError do
   end
 end
 
+describe Mustang::V8::TimeoutError do
+  it "#timeout_error? returns true" do
+    subject.should be_timeout_error
+  end
+
+  it "#error? returns true" do
+    subject.should be_error
+  end
+end
+
 describe Mustang::V8::TypeError do
   it "#type_error? returns true" do
     subject.should be_type_error
@@ -26,6 +26,35 @@ describe Mustang::V8::Function do
         func = subject.new(lambda {|bar| "foo#{bar}"})
         func.call("foo").should == "foofoo"
       end
+
+      it "rethrows ruby exceptions raised by it as javascript errors" do
+        cxt[:fail] = subject.new(lambda { raise "failed" })
+        cxt.eval("try { fail() } catch(e) { e.message }", "<eval>").should == "failed"
+      end
+
+      it "passes throws out of it through javascript" do
+        cxt[:jump] = subject.new(lambda { throw :done, 1 })
+        catch(:done) { cxt.eval("try { jump() } catch(e) {}; 2", "<eval>") }.should == 1
+        cxt.eval("1+1", "<eval>").should == 2
+      end
+
+      it "passes thread kills out of it through javascript" do
+        reached = false
+        Thread.new {
+          Mustang::V8::Isolate.new.enter {
+            cxt = Mustang::V8::Context.new
+            cxt[:kill] = subject.new(lambda { Thread.current.kill })
+            cxt.eval("try { kill() } catch(e) {}", "<eval>")
+            reached = true
+          }
+        }.join
+        reached.should be_false
+      end
+
+      it "passes long argument lists to it" do
+        func = subject.new(lambda {|*args| args.inject(0) {|sum,x| sum+x } })
+        func.call(*(1..20).to_a).should == 210
+      end
     end
 
     context "when block given" do
@@ -66,6 +95,49 @@ describe Mustang::V8::Function do
     end
   end
 
+  describe "#call_many" do
+    let(:func) { cxt.eval("var f = function(a, b) { if (a < 0) throw new TypeError('negative'); return a + (b || 0) }; f;", "<eval>") }
+
+    it "executes function with each tuple of arguments" do
+      func.call_many(nil, [[1, 2], [3, 4], 5]).should == [3, 7, 5]
+    end
+
+    it "calls many more functions than single batch" do
+      func.call_many(nil, (1..1000).map { |i| [i, 1] }).last.should == 1001
+    end
+
+    it "returns errors of broken calls in place of results" do
+      res = func.call_many(nil, [[1, 1], [-1, 1], [2, 2]])
+      res[0].should == 2
+      res[1].should be_type_error
+      res[2].should == 4
+    end
+
+    it "executes function on given receiver" do
+      func = cxt.eval("var g = function(foo) { return this+foo }; g;", "<eval>")
+      func.call_many(10.to_v8, [[1], [2]]).should == [11, 12]
+    end
+
+    it "raises errors of broken tuple conversions" do
+      expect { func.call_many(nil, [[1, 2], [1.0..2.0]]) }.to raise_error(TypeError)
+      func.call_many(nil, [[1, 2]]).should == [3]
+    end
+  end
+
+  describe "#call_each" do
+    let(:func) { cxt.eval("var f = function(a) { return a * 2 }; f;", "<eval>") }
+
+    it "yields results of calls with streamed tuples" do
+      res = []
+      func.call_each(nil, (1..5).each, 2) { |x| res << x }
+      res.should == [2, 4, 6, 8, 10]
+    end
+
+    it "returns enumerator when no block given" do
+      func.call_each(nil, [[1], [2]]).to_a.should == [2, 4]
+    end
+  end
+
   describe "#call" do
     it "exectutes referenced javascript function" do
       func = cxt.eval("var f = function(foo, bar) { return foo+bar }; f;", "<eval>")
@@ -0,0 +1,56 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe Mustang::V8::HeapSnapshot do
+  subject { Mustang::V8::HeapSnapshot }
+  setup_context
+
+  describe ".take" do
+    it "takes snapshot of the heap" do
+      snapshot = subject.take("test")
+      snapshot.should be_kind_of(subject)
+      snapshot.title.should == "test"
+    end
+  end
+
+  describe "#summary" do
+    it "returns objects grouped by constructor" do
+      cxt.eval("function Foo() { this.bar = [1,2,3] }; var foos = []; for (var i=0; i<100; i++) { foos.push(new Foo()) }", "<eval>")
+      foo = subject.take.summary["Foo"]
+      foo[:count].should == 100
+      foo[:self_size].should > 0
+      foo[:retained_size].should >= foo[:self_size]
+    end
+  end
+
+  describe "#diff" do
+    it "returns objects allocated and freed between snapshots" do
+      cxt.eval("function Bar() {}; var bars = []; for (var i=0; i<10; i++) { bars.push(new Bar()) }", "<eval>")
+      before = subject.take
+      cxt.eval("bars = []; for (var i=0; i<25; i++) { bars.push(new Bar()) }", "<eval>")
+      diff = subject.take.diff(before)
+      diff["Bar"][:added][:count].should == 25
+      diff["Bar"][:deleted][:count].should == 10
+    end
+
+    it "raises error when other value is not a snapshot" do
+      expect { subject.take.diff(1) }.to raise_error(TypeError)
+    end
+  end
+
+  describe "#wrapper_retained" do
+    it "returns objects kept alive only by ruby wrappers" do
+      cxt.eval("function Baz() {}; var kept = new Baz()", "<eval>")
+      orphan = cxt.eval("new Baz()", "<eval>")
+      names = subject.take.wrapper_retained.map { |entry| entry[:name] }
+      names.count("Baz").should == 1
+    end
+  end
+
+  describe "#delete" do
+    it "deletes the snapshot" do
+      snapshot = subject.take
+      snapshot.delete
+      expect { snapshot.summary }.to raise_error(RuntimeError, "heap snapshot has been deleted")
+    end
+  end
+end
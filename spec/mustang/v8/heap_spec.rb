@@ -0,0 +1,76 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe Mustang::V8 do
+  describe ".set_resource_constraints" do
+    it "limits heap of isolate which is not set up yet" do
+      Mustang::V8::Isolate.new.enter {
+        Mustang::V8.set_resource_constraints(:max_young_space => 2 << 20, :max_old_space => 64 << 20).should be_true
+      }
+    end
+
+    it "returns false when heap is already set up" do
+      Mustang::V8::Isolate.new.enter {
+        Mustang::V8::Context.new
+        Mustang::V8.set_resource_constraints(:max_old_space => 64 << 20).should be_false
+      }
+    end
+
+    it "limits javascript stack" do
+      Mustang::V8::Isolate.new.enter {
+        Mustang::V8.set_resource_constraints(:stack_limit => 64 << 10).should be_true
+        cxt = Mustang::V8::Context.new
+        cxt.eval("function a() { a() }; a()", "<eval>").should be_range_error
+      }
+    end
+
+    it "raises error naming invalid constraint" do
+      expect { Mustang::V8.set_resource_constraints(:max_old_space => 2 << 30) }.to raise_error(ArgumentError, /:max_old_space/)
+      expect { Mustang::V8.set_resource_constraints(:stack_limit => -1) }.to raise_error(ArgumentError, /:stack_limit/)
+      expect { Mustang::V8.set_resource_constraints(:max_executable => "1") }.to raise_error(ArgumentError, /:max_executable/)
+    end
+  end
+
+  describe ".idle_notification" do
+    it "returns true or false" do
+      [true, false].should include(Mustang::V8.idle_notification)
+    end
+  end
+
+  describe ".low_memory_notification" do
+    it "returns nil" do
+      Mustang::V8.low_memory_notification.should be_nil
+    end
+  end
+
+  describe ".heap_statistics" do
+    it "returns sizes of the heap" do
+      stats = Mustang::V8.heap_statistics
+      stats.keys.map(&:to_s).sort.should == %w[heap_size_limit total_heap_size total_heap_size_executable used_heap_size]
+      stats[:used_heap_size].should > 0
+      stats[:used_heap_size].should <= stats[:total_heap_size]
+    end
+  end
+
+  describe ".gc_statistics" do
+    it "returns recorded collections by type" do
+      Mustang::V8.track_gc
+      Mustang::V8.low_memory_notification
+      stats = Mustang::V8.gc_statistics
+      stats[:mark_sweep_compact][:count].should > 0
+      stats[:mark_sweep_compact][:pause_max].should >= stats[:mark_sweep_compact][:pause_last]
+      stats[:scavenge].keys.map(&:to_s).sort.should == %w[count pause_last pause_max pause_total]
+    end
+  end
+
+  describe ".wrapper_statistics" do
+    setup_context
+
+    it "returns numbers of live wrappers" do
+      before = Mustang::V8.wrapper_statistics
+      objs = 10.times.map { Mustang::V8::Object.new }
+      after = Mustang::V8.wrapper_statistics
+      (after[:wrappers] - before[:wrappers]).should >= 10
+      (after[:peers] - before[:peers]).should >= 10
+    end
+  end
+end
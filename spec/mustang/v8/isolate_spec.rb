@@ -0,0 +1,128 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+require 'thread'
+
+describe Mustang::V8::Isolate do
+  subject { Mustang::V8::Isolate.new }
+  after { subject.exit while subject.entered? }
+
+  describe ".current" do
+    it "returns nil when default isolate is used" do
+      Mustang::V8::Isolate.current.should_not be
+    end
+
+    it "returns entered isolate" do
+      subject.enter { |iso| Mustang::V8::Isolate.current.should == iso }
+    end
+  end
+
+  describe "#enter" do
+    context "when block given" do
+      it "enters isolate for block execution, and exits after that" do
+        entered = false
+        subject.enter { |iso| entered = iso.entered? }
+        entered.should be_true
+        subject.should_not be_entered
+      end
+
+      it "returns block result" do
+        subject.enter { 1 }.should == 1
+      end
+    end
+
+    context "when no block given" do
+      it "enters isolate" do
+        subject.enter.should be_true
+        subject.should be_entered
+      end
+    end
+
+    context "when entered by another thread" do
+      it "raises error" do
+        iso, entered, checked = subject, Queue.new, Queue.new
+        thread = Thread.new { iso.enter; entered << true; checked.pop; iso.exit }
+        entered.pop
+        expect { iso.enter }.to raise_error(RuntimeError, "isolate is already entered by another thread")
+        checked << true
+        thread.join
+        iso.should_not be_entered
+      end
+    end
+
+    context "when disposed" do
+      it "raises error" do
+        subject.dispose
+        expect { subject.enter }.to raise_error(RuntimeError, "can't enter disposed isolate")
+      end
+    end
+  end
+
+  describe "#exit" do
+    it "exits from isolate" do
+      subject.enter
+      subject.exit.should_not be
+      subject.should_not be_entered
+    end
+  end
+
+  describe "#dispose" do
+    it "disposes isolate" do
+      subject.dispose
+      subject.should be_disposed
+    end
+
+    context "when isolate is entered" do
+      it "raises error" do
+        subject.enter
+        expect { subject.dispose }.to raise_error(RuntimeError, "can't dispose entered isolate")
+      end
+    end
+
+    it "makes objects which belong to the isolate unusable" do
+      cxt = nil
+      subject.enter { cxt = Mustang::V8::Context.new }
+      subject.dispose
+      expect { cxt.global }.to raise_error(RuntimeError, "can't use V8 object which belongs to disposed isolate")
+    end
+  end
+
+  describe "in isolate" do
+    it "objects are tagged with owning isolate" do
+      subject.enter do |iso|
+        cxt = Mustang::V8::Context.new
+        cxt.isolate.should == iso
+        cxt.eval("({a: 1})", "<eval>").isolate.should == iso
+        cxt.exit
+      end
+    end
+
+    it "globals are isolated from the default isolate" do
+      cxt = Mustang::V8::Context.new
+      cxt.eval("var foo = 'default'", "<eval>")
+      cxt.isolate.should_not be
+      subject.enter do
+        other = Mustang::V8::Context.new
+        other.eval("typeof foo", "<eval>").should == 'undefined'
+        other.exit
+      end
+    end
+
+    it "runs javascript in parallel with other threads" do
+      isolates = Array.new(2) { Mustang::V8::Isolate.new }
+      started = Time.now
+      threads = isolates.map { |iso|
+        Thread.new {
+          iso.enter {
+            cxt = Mustang::V8::Context.new
+            res = cxt.eval("var s=0, end=Date.now()+300; while (Date.now() < end) { s++ }; s > 0", "<eval>")
+            cxt.exit
+            res
+          }
+        }
+      }
+      threads.map { |t| t.value }.should == [true, true]
+      # Each script runs for 300ms, so both take 600ms when serialized...
+      (Time.now - started).should < 0.5
+      isolates.each { |iso| iso.dispose }
+    end
+  end
+end
@@ -0,0 +1,71 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+require 'rbconfig'
+
+# Once V8 lock is used, all threads have to use V8 from within locked blocks,
+# so all examples are executed in separate processes.
+def run_isolated(code)
+  lib = File.expand_path("../../../../lib", __FILE__)
+  ext = File.expand_path("../../../../ext", __FILE__)
+  IO.popen([RbConfig.ruby, "-I", lib, "-I", ext, "-rmustang", "-e", code]) { |io| io.read }
+end
+
+describe Mustang::V8 do
+  describe ".lock" do
+    it "executes given block holding the V8 lock" do
+      run_isolated("p Mustang::V8.locked?; Mustang::V8.lock { p Mustang::V8.locked? }").should == "false\ntrue\n"
+    end
+
+    it "runs javascript without blocking other ruby threads" do
+      run_isolated(<<-RUBY).should == "true\n2\n"
+        ticks = 0
+        ticker = Thread.new { loop { ticks += 1; sleep 0.01 } }
+        Mustang::V8.lock {
+          cxt = Mustang::V8::Context.new
+          res = cxt.eval("var i=0, d=new Date(); while (new Date()-d < 300) { i++ }; 2", "<eval>")
+          p ticks > 5
+          p res.to_i
+        }
+      RUBY
+    end
+
+    it "reacquires GVL when javascript calls ruby code" do
+      run_isolated(<<-RUBY).should == "\"foobar\"\n"
+        Mustang::V8.lock {
+          cxt = Mustang::V8::Context.new
+          cxt[:foo] = lambda { |bar| "foo" + bar.to_s }
+          p cxt.eval("foo('bar')", "<eval>").to_s
+        }
+      RUBY
+    end
+  end
+
+  describe ".start_preemption" do
+    it "lets threads waiting for the V8 lock run in turns" do
+      run_isolated(<<-RUBY).should == "true\n"
+        Mustang::V8.lock { Mustang::V8.start_preemption(10) }
+        order = []
+        threads = 2.times.map { |i|
+          Thread.new {
+            Mustang::V8.lock {
+              cxt = Mustang::V8::Context.new
+              cxt[:mark] = lambda { order << i }
+              cxt.eval("var d=new Date(); mark(); while (new Date()-d < 200) {}; mark()", "<eval>")
+            }
+          }
+        }
+        threads.each(&:join)
+        p order.first(2).sort == [0, 1]
+      RUBY
+    end
+
+    it "raises error when the V8 lock is not held" do
+      run_isolated("begin; Mustang::V8.start_preemption(10); rescue RuntimeError; p true; end").should == "true\n"
+    end
+  end
+
+  describe ".unlock" do
+    it "executes given block without the V8 lock" do
+      run_isolated("Mustang::V8.lock { Mustang::V8.unlock { p Mustang::V8.locked? }; p Mustang::V8.locked? }").should == "false\ntrue\n"
+    end
+  end
+end
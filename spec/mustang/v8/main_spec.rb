@@ -6,6 +6,11 @@ describe Mustang::V8 do
     subject.version.should =~ /^\d.\d.\d$/
   end
 
+  it "responds to .snapshot?" do
+    subject.should respond_to(:snapshot?)
+    [true, false].should include(subject.snapshot?)
+  end
+
   it "responds to .dead?" do
     subject.should respond_to(:dead?)
     subject.should_not be_dead
@@ -29,6 +29,74 @@ describe Mustang::V8::Object do
     end
   end
   
+  context "when ruby object passed" do
+    class Reflected
+      def initialize(name); @name = name; end
+      def name; @name; end
+      def greet(who); "#{@name} greets #{who}"; end
+      def fail!; raise "failed"; end
+    end
+
+    it "reflects its methods in the prototype" do
+      obj = subject.new(Reflected.new("foo"))
+      cxt[:obj] = obj
+      cxt.eval("obj.greet('bar')", "<eval>").should == "foo greets bar"
+      cxt.eval("obj.hasOwnProperty('greet')", "<eval>").should == false
+    end
+
+    it "shares the prototype between instances of the same class" do
+      cxt[:a] = Reflected.new("a")
+      cxt[:b] = Reflected.new("b")
+      cxt.eval("a.greet === b.greet", "<eval>").should == true
+      cxt.eval("a.name() + b.name()", "<eval>").should == "ab"
+    end
+
+    it "throws error when method is called on foreign receiver" do
+      cxt[:a] = Reflected.new("a")
+      cxt.eval("a.name.call({})", "<eval>").should be_kind_of(Mustang::V8::TypeError)
+    end
+
+    it "rethrows ruby exceptions raised by methods as javascript errors" do
+      cxt[:a] = Reflected.new("a")
+      cxt.eval("try { a.fail_bang() } catch(e) { e.message }", "<eval>").should == "failed"
+    end
+  end
+
+  describe ".proxy" do
+    it "exposes hash keys lazily" do
+      hash = {"foo" => 1, :bar => 2}
+      cxt[:hash] = subject.proxy(hash)
+      cxt.eval("hash.foo + hash.bar", "<eval>").should == 3
+      cxt.eval("hash.spam = 'eggs'; delete hash.foo; Object.keys(hash).length", "<eval>").should == 2
+      hash.keys.should =~ [:bar, "spam"]
+    end
+
+    it "exposes array items lazily" do
+      ary = [1, 2, 3]
+      cxt[:ary] = subject.proxy(ary)
+      cxt.eval("ary.length + ary[2]", "<eval>").should == 6
+      cxt.eval("ary.map(function(x) { return x * 2 })", "<eval>").to_a.should == [2, 4, 6]
+      cxt.eval("ary[3] = 4", "<eval>")
+      ary.size.should == 4
+    end
+
+    it "resolves methods of ruby object on access" do
+      cxt[:str] = subject.proxy("foo")
+      cxt.eval("str.upcase()", "<eval>").should == "FOO"
+      cxt.eval("str.is_empty()", "<eval>").should == false
+    end
+
+    it "doesn't expose methods inherited from Object" do
+      cxt[:str] = subject.proxy("foo")
+      cxt.eval("[typeof str.send, typeof str.instance_eval, typeof str.method]", "<eval>").to_a.should == ['undefined'] * 3
+    end
+
+    it "rethrows ruby errors as javascript ones" do
+      cxt[:hash] = subject.proxy({}.freeze)
+      cxt.eval("hash.foo = 1", "<eval>").should be_kind_of(Mustang::V8::Error)
+    end
+  end
+
   describe "#[] and #[]=" do
     it "sets and gets values of given key from current object" do
       obj = subject.new
@@ -61,6 +129,35 @@ describe Mustang::V8::Object do
     end
   end
 
+  describe "#each_pair" do
+    let(:obj) { subject.new(:foo => 1, :bar => 2) }
+
+    it "yields property names together with values" do
+      res = {}
+      obj.each_pair { |k, v| res[k] = v }
+      res.should == {'foo' => 1, 'bar' => 2}
+    end
+
+    it "returns enumerator when no block given" do
+      obj.each_pair.to_a.should =~ [['foo', 1], ['bar', 2]]
+    end
+  end
+
+  describe "#include?" do
+    let(:obj) { subject.new(:foo => 1) }
+
+    it "returns true when object has given property" do
+      obj.should include("foo")
+      obj.should include(:foo)
+      obj.should_not include("bar")
+    end
+
+    it "is aliased with #has_key? and #key?" do
+      obj.should have_key(:foo)
+      obj.key?(:foo).should be_true
+    end
+  end
+
   describe "an instance" do
     it "is enumerable" do
       res = {}
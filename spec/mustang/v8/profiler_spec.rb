@@ -0,0 +1,57 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe Mustang::V8::Profiler do
+  setup_context
+
+  let(:source) {
+    "function hot() { var s=0; for (var i=0; i<100000; i++) { s += Math.sqrt(i) }; return s }\n" +
+    "function main() { var d=new Date(); while (new Date()-d < 300) { hot() } }\n" +
+    "main()"
+  }
+
+  describe ".start and .stop" do
+    it "returns call tree of the profile" do
+      subject.start("test")
+      cxt.eval(source, "hot.js")
+      tree = subject.stop("test")
+      tree.should be_kind_of(Hash)
+      tree[:children].should be_kind_of(Array)
+      tree[:total_ticks].should > 0
+    end
+
+    it "returns nil when profile was not started" do
+      subject.stop("missing").should be_nil
+    end
+  end
+
+  describe ".profile" do
+    let(:profile) { subject.profile { cxt.eval(source, "hot.js") } }
+
+    it "returns collected profile" do
+      profile.should be_kind_of(Mustang::V8::Profiler::Profile)
+      profile.ticks.should > 0
+    end
+
+    it "contains source positions of sampled functions" do
+      nodes = []
+      profile.each_node { |node, stack| nodes << node }
+      hot = nodes.find { |node| node.function_name == "hot" }
+      hot.script_name.should == "hot.js"
+      hot.line_no.should == 1
+    end
+
+    describe "#top" do
+      it "returns functions with the highest self ticks" do
+        top = profile.top(1)
+        top.size.should == 1
+        top.first.function_name.should == "hot"
+      end
+    end
+
+    describe "#to_collapsed" do
+      it "returns stacks in collapsed format" do
+        profile.to_collapsed.should =~ /main \(hot\.js:2\);hot \(hot\.js:1\) \d+/
+      end
+    end
+  end
+end
@@ -0,0 +1,99 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe Mustang::V8::Script do
+  subject { Mustang::V8::Script }
+  setup_context
+
+  it "inherits Mustang::V8::Data" do
+    subject.new("1+1").should be_kind_of(Mustang::V8::Data)
+  end
+
+  describe ".new" do
+    context "when no context entered" do
+      it "should raise error" do
+        Mustang::V8::Context.exit_all!
+        expect { subject.new("1+1") }.to raise_error(RuntimeError, "can't create V8 object without entering into context")
+      end
+    end
+
+    it "compiles given javascript source" do
+      script = subject.new("var a = 'foo'; a;", "<eval>")
+      script.should be_kind_of(Mustang::V8::Script)
+      script.filename.should == "<eval>"
+    end
+
+    it "keeps preparse data of compiled source" do
+      subject.new("var a = 'foo'; a;").data.should be_kind_of(String)
+    end
+
+    context "when preparse data given" do
+      it "compiles script using it" do
+        data = subject.precompile("var b = 'bar'; b;")
+        script = subject.new("var b = 'bar'; b;", "<eval>", data)
+        script.data.should == data
+        script.run.should == 'bar'
+      end
+    end
+
+    context "when source is broken" do
+      it "returns proper error" do
+        subject.new("broken {[/").should be_syntax_error
+      end
+    end
+  end
+
+  describe ".precompile" do
+    it "returns preparse data of given source" do
+      subject.precompile("function foo() { return 1 }").should be_kind_of(String)
+    end
+
+    it "works without entered context" do
+      Mustang::V8::Context.exit_all!
+      subject.precompile("var a = 1").should be
+    end
+  end
+
+  describe "#run" do
+    it "runs compiled script within entered context" do
+      script = subject.new("var c = (c || 0) + 1; c;")
+      script.run.should == 1
+      script.run.should == 2
+    end
+
+    context "when context given" do
+      it "runs script within it" do
+        script = subject.new("this.foo")
+        other = Mustang::V8::Context.new
+        other[:foo] = 'bar'
+        cxt.enter
+        script.run(other).should == 'bar'
+      end
+    end
+
+    context "when script cause errors" do
+      it "returns proper error" do
+        subject.new("broken$code").run.should be_reference_error
+      end
+    end
+
+    context "when timeout given" do
+      it "terminates execution which takes longer" do
+        script = subject.new("while(true){}")
+        script.run(nil, 0.1).should be_timeout_error
+        subject.new("1+1").run.should == 2
+      end
+    end
+  end
+
+  describe "#bind" do
+    it "binds script with given context" do
+      script = subject.new("this.foo")
+      other = Mustang::V8::Context.new
+      other[:foo] = 'spam'
+      script.bind(other)
+      script.context.should == other
+      cxt.enter
+      script.run.should == 'spam'
+    end
+  end
+end
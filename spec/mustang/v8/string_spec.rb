@@ -26,6 +26,17 @@ describe Mustang::V8::String do
     end
   end
 
+  context "when large ascii string given" do
+    it "is shared with V8 without changing its contents" do
+      str = "x" * 100_000
+      v8str = subject.new(str)
+      str << "y"
+      v8str.to_s.size.should == 100_000
+      cxt[:str] = str
+      cxt.eval("str.length", "<eval>").should == 100_001
+    end
+  end
+
   describe "#to_ascii" do
     it "returns ASCII value of represented string" do
       subject.new("foobar").to_ascii.should == "foobar"
@@ -40,6 +51,37 @@ describe Mustang::V8::String do
     it "is aliased by #to_s" do
       subject.new("foobar").to_s.should == "foobar"
     end
+
+    it "returns UTF-8 encoded string" do
+      subject.new("zażółć").to_utf8.encoding.should == Encoding::UTF_8
+    end
+
+    it "doesn't truncate string at null character" do
+      subject.new("foo\0bar").to_utf8.should == "foo\0bar"
+    end
+  end
+
+  describe "#each_chunk" do
+    it "yields UTF-8 contents of string in chunks of given size" do
+      chunks = []
+      subject.new("zażółć gęślą").each_chunk(5) { |chunk| chunks << chunk }
+      chunks.should == ["zażół", "ć gęś", "lą"]
+    end
+
+    it "doesn't split surrogate pairs" do
+      str = cxt.eval("'a\\uD83D\\uDE00b'", "<eval>")
+      str.each_chunk(2).to_a.should == ["a", "\u{1F600}", "b"]
+    end
+
+    it "returns enumerator when no block given" do
+      subject.new("foo").each_chunk.to_a.should == ["foo"]
+    end
+
+    it "stops when block breaks or raises" do
+      subject.new("foobar").each_chunk(3) { |chunk| break chunk }.should == "foo"
+      expect { subject.new("foobar").each_chunk(3) { raise "failed" } }.to raise_error(RuntimeError, "failed")
+      subject.new("spam").each_chunk(2).to_a.should == ["sp", "am"]
+    end
   end
 
   describe "an instance" do
@@ -1,4 +1,5 @@
 require File.dirname(__FILE__) + '/../../spec_helper'
+require 'stringio'
 
 describe Mustang::V8::Value do
   subject { Mustang::V8::Value }
@@ -202,6 +203,34 @@ describe Mustang::V8::Value do
     end
   end
 
+  describe "#to_json" do
+    it "returns value serialized to json" do
+      obj = cxt.eval("({foo: [1, 2], bar: 'spam'})", "<eval>")
+      obj.to_json.should == '{"foo":[1,2],"bar":"spam"}'
+    end
+
+    it "returns null when value can't be represented in json" do
+      cxt.eval("(function() {})", "<eval>").to_json.should == 'null'
+    end
+
+    it "raises errors of serializer" do
+      obj = cxt.eval("var a = {}; a.a = a; a", "<eval>")
+      expect { obj.to_json }.to raise_error(RuntimeError, /TypeError/)
+    end
+
+    it "writes serialized value to given io" do
+      io = StringIO.new
+      cxt.eval("({foo: 'bar'})", "<eval>").to_json(io).should == io
+      io.string.should == '{"foo":"bar"}'
+    end
+
+    it "raises errors of given io after leaving javascript" do
+      io = StringIO.new.tap { |io| io.close }
+      expect { cxt.eval("({foo: 'bar'})", "<eval>").to_json(io) }.to raise_error(IOError)
+      cxt.eval("try { null.foo } catch(e) { 'caught' }", "<eval>").should == 'caught'
+    end
+  end
+
   describe "null?" do
     it "returns true when object is not null" do
       Mustang::V8::Object.new.should_not be_null